@@ -0,0 +1,175 @@
+// Clox Benchmark Runner
+// Run Lox benchmark scripts several times with Clox and print their median
+// wall time and peak resident set size as tab-separated values. Each script is
+// given a scratch directory as its argument, which is removed afterwards.
+
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// The maximum number of runs per benchmark.
+#define RUNS_MAX 100
+
+// The result of running a benchmark once.
+typedef struct {
+	// The run's wall time in milliseconds.
+	double milliseconds;
+	
+	// The run's peak resident set size in kibibytes.
+	long peakKibibytes;
+} RunResult;
+
+// Get the current time of a monotonic clock in milliseconds.
+static double getMilliseconds() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (double)time.tv_sec * 1e3 + (double)time.tv_nsec / 1e6;
+}
+
+// Run a benchmark script once with Clox and a scratch directory, and return
+// whether it exited successfully. The script's standard output is discarded.
+static bool runOnce(const char *cloxPath, const char *scriptPath, const char *scratchPath, RunResult *result) {
+	double start = getMilliseconds();
+	pid_t pid = fork();
+	
+	if (pid == -1) {
+		return false; // Could not fork.
+	}
+	
+	if (pid == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		
+		if (null != -1) {
+			dup2(null, STDOUT_FILENO);
+			close(null);
+		}
+		
+		execl(cloxPath, cloxPath, scriptPath, scratchPath, (char*)NULL);
+		_exit(127); // Could not execute Clox.
+	}
+	
+	int status;
+	struct rusage usage;
+	
+	if (wait4(pid, &status, 0, &usage) == -1) {
+		return false; // Could not wait for Clox.
+	}
+	
+	result->milliseconds = getMilliseconds() - start;
+	result->peakKibibytes = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Remove a scratch directory and the files in it.
+static void removeScratch(const char *scratchPath) {
+	DIR *dir = opendir(scratchPath);
+	
+	if (dir != NULL) {
+		for (struct dirent *entry; (entry = readdir(dir)) != NULL;) {
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+				continue;
+			}
+			
+			char path[4096];
+			snprintf(path, sizeof(path), "%s/%s", scratchPath, entry->d_name);
+			unlink(path);
+		}
+		
+		closedir(dir);
+	}
+	
+	rmdir(scratchPath);
+}
+
+// Compare two doubles in ascending order.
+static int compareDoubles(const void *a, const void *b) {
+	double doubleA = *(const double*)a;
+	double doubleB = *(const double*)b;
+	return (doubleA > doubleB) - (doubleA < doubleB);
+}
+
+// Get a benchmark's name from its script path without directories or an
+// extension.
+static void getName(const char *scriptPath, char *name, size_t size) {
+	const char *start = strrchr(scriptPath, '/');
+	start = start == NULL ? scriptPath : start + 1;
+	const char *end = strrchr(start, '.');
+	size_t length = end == NULL ? strlen(start) : (size_t)(end - start);
+	
+	if (length >= size) {
+		length = size - 1;
+	}
+	
+	memcpy(name, start, length);
+	name[length] = '\0';
+}
+
+// Run benchmark scripts from arguments and return an exit status code.
+int main(int argc, const char *argv[]) {
+	if (argc < 4) {
+		fprintf(stderr, "Usage: bench <runs> <clox> <script>...\n");
+		return 64;
+	}
+	
+	char *end;
+	long runs = strtol(argv[1], &end, 10);
+	
+	if (*end != '\0' || runs < 1 || runs > RUNS_MAX) {
+		fprintf(stderr, "Runs must be between 1 and %d.\n", RUNS_MAX);
+		return 64;
+	}
+	
+	const char *cloxPath = argv[2];
+	char scratchPath[] = "/tmp/clox_bench_XXXXXX";
+	
+	if (mkdtemp(scratchPath) == NULL) {
+		fprintf(stderr, "Could not make a scratch directory.\n");
+		return 74;
+	}
+	
+	bool isOk = true;
+	printf("benchmark\truns\tmedian_ms\tpeak_rss_kib\n");
+	
+	for (int i = 3; i < argc; i++) {
+		double times[RUNS_MAX];
+		long peakKibibytes = 0;
+		bool isPassing = true;
+		
+		for (int run = 0; run < runs && isPassing; run++) {
+			RunResult result = {0.0, 0};
+			isPassing = runOnce(cloxPath, argv[i], scratchPath, &result);
+			times[run] = result.milliseconds;
+			
+			if (result.peakKibibytes > peakKibibytes) {
+				peakKibibytes = result.peakKibibytes;
+			}
+		}
+		
+		char name[256];
+		getName(argv[i], name, sizeof(name));
+		
+		if (!isPassing) {
+			fprintf(stderr, "Benchmark '%s' failed.\n", argv[i]);
+			printf("%s\t%ld\tfailed\tfailed\n", name, runs);
+			isOk = false;
+			continue;
+		}
+		
+		qsort(times, (size_t)runs, sizeof(double), compareDoubles);
+		double median = runs % 2 == 1 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+		printf("%s\t%ld\t%.3f\t%ld\n", name, runs, median, peakKibibytes);
+		fflush(stdout);
+	}
+	
+	removeScratch(scratchPath);
+	return isOk ? 0 : 1;
+}
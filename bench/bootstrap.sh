@@ -0,0 +1,73 @@
+#!/bin/sh
+# Lynx Bootstrap Benchmark
+# Run each stage of the Lynx bootstrap with VM statistics and Lynx phase
+# timings, write them as tab-separated values, and compare them to the
+# previous results.
+# Usage: bootstrap.sh <clox> <results>
+
+set -e
+
+if [ $# -ne 2 ]; then
+	echo "Usage: bootstrap.sh <clox> <results>" 1>&2
+	exit 64
+fi
+
+CLOX=$1
+RESULTS=$2
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf -- "$WORK_DIR"' EXIT
+printf 'stage\tmetric\tvalue\n' > "$WORK_DIR/results.tsv"
+
+# Append a stage's statistics file to the results with a metric prefix and
+# suffix.
+append() {
+	awk -v stage="$1" -v prefix="$3" -v suffix="$4" \
+		'{ print stage "\t" prefix $1 suffix "\t" $2 }' "$2" >> "$WORK_DIR/results.tsv"
+}
+
+# Run a stage with VM statistics from its name and Clox arguments.
+stage() {
+	name=$1
+	shift
+	echo "Running stage '$name'..." 1>&2
+	"$CLOX" --vm-stats "$WORK_DIR/$name.vm.tsv" "$@" > /dev/null
+	append "$name" "$WORK_DIR/$name.vm.tsv" "" ""
+}
+
+# Run a Lynx stage with VM statistics and Lynx phase timings from its name,
+# Lynx script, and output path.
+lynx() {
+	stage "$1" "$2" --std std --output "$3" --timings "$WORK_DIR/$1.lynx.tsv" -- lynx/main.lox
+	append "$1" "$WORK_DIR/$1.lynx.tsv" "lynx_" "_ms"
+}
+
+stage merge utils/merge.lox lynx/merge.txt std "$WORK_DIR/lynx_stage_0.lox"
+lynx stage_1 "$WORK_DIR/lynx_stage_0.lox" "$WORK_DIR/lynx_stage_1.lox"
+lynx stage_2 "$WORK_DIR/lynx_stage_1.lox" "$WORK_DIR/lynx_stage_2.lox"
+lynx lynx "$WORK_DIR/lynx_stage_2.lox" "$WORK_DIR/lynx.lox"
+stage compare utils/compare.lox "$WORK_DIR/lynx.lox" "$WORK_DIR/lynx_stage_2.lox"
+
+if [ -f "$RESULTS" ]; then
+	awk -F '\t' '
+		FNR == 1 { next }
+		NR == FNR { old[$1 "\t" $2] = $3; next }
+		{
+			key = $1 "\t" $2
+			
+			if (!(key in old)) {
+				change = "new"
+			} else if (old[key] != 0) {
+				change = sprintf("%+.1f%%", ($3 - old[key]) * 100 / old[key])
+			} else {
+				change = "-"
+			}
+			
+			printf "%-10s %-20s %16s %16s %8s\n", $1, $2, old[key], $3, change
+		}
+		BEGIN { printf "%-10s %-20s %16s %16s %8s\n", "stage", "metric", "previous", "current", "change" }
+	' "$RESULTS" "$WORK_DIR/results.tsv"
+else
+	cat "$WORK_DIR/results.tsv"
+fi
+
+cp "$WORK_DIR/results.tsv" "$RESULTS"
@@ -0,0 +1,80 @@
+#!/bin/sh
+# Lynx Coverage
+# Run an unpreprocessed Lynx on its own sources with line coverage, then map
+# the coverage and hottest lines of the merged script back to the source files
+# in its merge list.
+# Usage: coverage.sh <clox> <list> <std> <tracefile>
+
+set -e
+
+if [ $# -ne 4 ]; then
+	echo "Usage: coverage.sh <clox> <list> <std> <tracefile>" 1>&2
+	exit 64
+fi
+
+CLOX=$1
+LIST=$2
+STD=$3
+TRACEFILE=$4
+BASE_DIR=$(dirname "$LIST")
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf -- "$WORK_DIR"' EXIT
+
+# Print the first line of each source file in the merged script and its path
+# as tab-separated values.
+sources() {
+	line=1
+	
+	sed 's/#.*//' "$LIST" | awk 'NF' | while read -r path; do
+		case $path in
+			"<"*) path="$STD/$(echo "$path" | sed 's/[<> ]//g').lox" ;;
+			*) path="$BASE_DIR/$path" ;;
+		esac
+		
+		printf '%s\t%s\n' "$line" "$path"
+		line=$((line + $(wc -l < "$path")))
+	done
+}
+
+# The awk function that maps a merged line to its source file and line.
+LOCATE='
+	function locate(line, i) {
+		for (i = sourceCount; i > 1 && starts[i] > line; i--) {}
+		sourceIndex = i
+		return line - starts[i] + 1
+	}
+	
+	NR == FNR { sourceCount++; starts[sourceCount] = $1; paths[sourceCount] = $2; next }
+'
+
+echo "Merging Lynx..." 1>&2
+"$CLOX" utils/merge.lox "$LIST" "$STD" "$WORK_DIR/lynx.lox"
+sources > "$WORK_DIR/sources.tsv"
+
+echo "Running Lynx with coverage..." 1>&2
+"$CLOX" --coverage "$WORK_DIR/lynx.info" "$WORK_DIR/lynx.lox" \
+	--std "$STD" --output "$WORK_DIR/output.lox" -- "$BASE_DIR/main.lox" 2> "$WORK_DIR/hot.txt"
+
+awk -F '\t' "$LOCATE"'
+	FNR == 1 { FS = "[:,]" }
+	$1 == "FN" { local = locate($2); fn[sourceIndex] = fn[sourceIndex] "FN:" local "," $3 ":" local "\n"; fnf[sourceIndex]++; names[$3 ":" $4] = $3 ":" local; files[$3 ":" $4] = sourceIndex }
+	$1 == "FNDA" { i = files[$3 ":" $4]; fn[i] = fn[i] "FNDA:" $2 "," names[$3 ":" $4] "\n"; fnh[i] += $2 > 0 }
+	$1 == "DA" { local = locate($2); da[sourceIndex] = da[sourceIndex] "DA:" local "," $3 "\n"; lf[sourceIndex]++; lh[sourceIndex] += $3 > 0 }
+	END {
+		for (i = 1; i <= sourceCount; i++) {
+			printf "TN:\nSF:%s\n%sFNF:%d\nFNH:%d\n%sLF:%d\nLH:%d\nend_of_record\n", paths[i], fn[i], fnf[i], fnh[i], da[i], lf[i], lh[i]
+		}
+	}
+' "$WORK_DIR/sources.tsv" "$WORK_DIR/lynx.info" > "$TRACEFILE"
+
+awk -F '\t' "$LOCATE"'
+	FNR == 1 { FS = " " }
+	FNR <= 2 { next }
+	{
+		local = locate($3)
+		source = $0
+		sub(/^ *[^ ]+ +[^ ]+ +[^ ]+  /, "", source)
+		printf "%14s %12s  %-48s %s\n", $1, $2, paths[sourceIndex] ":" local, source
+	}
+	BEGIN { printf "%14s %12s  %-48s %s\n", "instructions", "hits", "location", "source" }
+' "$WORK_DIR/sources.tsv" "$WORK_DIR/hot.txt"
@@ -0,0 +1,499 @@
+// Clox Microbenchmarks
+// Time the core data structures of Clox in isolation and print the median
+// nanoseconds per operation of each benchmark as tab-separated values.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chunk.h"
+#include "common.h"
+#include "memory.h"
+#include "object.h"
+#include "table.h"
+#include "timing.h"
+#include "vm.h"
+
+#ifdef EXTENSIONS
+#include "extension.h"
+#endif // EXTENSIONS
+
+// The minimum time of a sample in nanoseconds.
+#define SAMPLE_MIN_TIME 2000000
+
+// The number of samples of each benchmark.
+#define SAMPLE_COUNT 15
+
+// The capacity of the hash tables used by the table benchmarks.
+#define TABLE_CAPACITY 4096
+
+// The maximum length of a string used by the string benchmarks.
+#define STRING_MAX 1024
+
+// A function that runs a benchmark's operation a number of times from the
+// benchmark's parameter, and returns the nanoseconds taken.
+typedef uint64_t (*BenchmarkFn)(int param, long iterations);
+
+// A benchmark.
+typedef struct {
+	// The benchmark's name.
+	const char *name;
+	
+	// The benchmark's function.
+	BenchmarkFn function;
+	
+	// The benchmark's parameter.
+	int param;
+} Benchmark;
+
+// The values kept reachable from the stack while benchmarking.
+static ObjArray *roots = NULL;
+
+// The sink for benchmark results that must not be optimized away.
+static volatile uint64_t sink = 0;
+
+// The keys in the benchmark hash table.
+static ObjString *tableKeys[TABLE_CAPACITY];
+
+// The keys missing from the benchmark hash table.
+static ObjString *missingKeys[TABLE_CAPACITY];
+
+// The benchmark hash table.
+static Table table;
+
+// The buffer for building string contents.
+static char stringChars[STRING_MAX + 1];
+
+// Stop the garbage collector from running unless it is called directly.
+static void pauseGC() {
+	vm.nextGC = SIZE_MAX;
+}
+
+// Collect all garbage that is not kept by the benchmarks.
+static void collectAll() {
+	collectGarbage();
+	pauseGC();
+}
+
+// Keep a value reachable until the heap is reset.
+static void keepValue(Value value) {
+	writeValueArray(&roots->elements, value);
+}
+
+// Initialize a fresh virtual machine with an array of kept values, so that no
+// benchmark sees the interned strings or heap of an earlier one.
+static void initBenchmarkVM() {
+	initVM();
+	roots = newArray();
+	push(OBJ_VAL(roots));
+	collectAll();
+}
+
+// Free the virtual machine and every value kept by a benchmark.
+static void freeBenchmarkVM() {
+	freeVM();
+	roots = NULL;
+}
+
+// Release all kept values and collect them.
+static void resetHeap() {
+	roots->elements.count = 0;
+	collectAll();
+}
+
+// Make and keep a string from a prefix and a number.
+static ObjString *makeKey(const char *prefix, int number) {
+	char chars[32];
+	int length = snprintf(chars, sizeof(chars), "%s%d", prefix, number);
+	ObjString *key = copyString(chars, length);
+	keepValue(OBJ_VAL(key));
+	return key;
+}
+
+// Fill the benchmark hash table to a load factor percentage of its capacity
+// and return its number of keys.
+static int fillTable(int loadPercent) {
+	int count = TABLE_CAPACITY * loadPercent / 100;
+	initTable(&table);
+	table.entries = ALLOCATE(Entry, TABLE_CAPACITY);
+	table.capacity = TABLE_CAPACITY;
+	
+	for (int i = 0; i < TABLE_CAPACITY; i++) {
+		table.entries[i].key = NIL_VAL;
+		table.entries[i].value = NIL_VAL;
+		tableKeys[i] = makeKey("key", i);
+		missingKeys[i] = makeKey("missing", i);
+	}
+	
+	for (int i = 0; i < count; i++) {
+		tableSet(&table, tableKeys[i], NUMBER_VAL(i));
+	}
+	
+	return count;
+}
+
+// Free the benchmark hash table and its keys.
+static void freeBenchmarkTable() {
+	freeTable(&table);
+	resetHeap();
+}
+
+// Benchmark getting keys that exist from a hash table at a load factor.
+static uint64_t benchTableGetHit(int loadPercent, long iterations) {
+	int count = fillTable(loadPercent);
+	Value value;
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		sink += tableGet(&table, tableKeys[i % count], &value);
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	freeBenchmarkTable();
+	return time;
+}
+
+// Benchmark getting keys that do not exist from a hash table at a load
+// factor.
+static uint64_t benchTableGetMiss(int loadPercent, long iterations) {
+	fillTable(loadPercent);
+	Value value;
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		sink += tableGet(&table, missingKeys[i % TABLE_CAPACITY], &value);
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	freeBenchmarkTable();
+	return time;
+}
+
+// Benchmark setting keys that exist in a hash table at a load factor.
+static uint64_t benchTableSet(int loadPercent, long iterations) {
+	int count = fillTable(loadPercent);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		sink += tableSet(&table, tableKeys[i % count], NUMBER_VAL(i));
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	freeBenchmarkTable();
+	return time;
+}
+
+// Benchmark deleting and setting again keys that exist in a hash table at a
+// load factor.
+static uint64_t benchTableDelete(int loadPercent, long iterations) {
+	int count = fillTable(loadPercent);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		ObjString *key = tableKeys[i % count];
+		sink += tableDelete(&table, key);
+		sink += tableSet(&table, key, NUMBER_VAL(i));
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	freeBenchmarkTable();
+	return time;
+}
+
+// Fill the string contents buffer to a length with a pattern.
+static void fillStringChars(int length) {
+	for (int i = 0; i < length; i++) {
+		stringChars[i] = (char)('a' + i % 26);
+	}
+	
+	stringChars[length] = '\0';
+}
+
+// Write a number to the start of the string contents buffer without changing
+// its length.
+static void writeStringNumber(int length, long number) {
+	for (int i = 0; i < length && i < 16; i++) {
+		stringChars[i] = (char)('a' + number % 26);
+		number /= 26;
+	}
+}
+
+// Benchmark hashing a string of a length.
+static uint64_t benchHashString(int length, long iterations) {
+	fillStringChars(length);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		sink += hashString(stringChars, length);
+	}
+	
+	return getNanoseconds() - start;
+}
+
+// Benchmark copying a string of a length that is already interned.
+static uint64_t benchCopyStringHit(int length, long iterations) {
+	fillStringChars(length);
+	keepValue(OBJ_VAL(copyString(stringChars, length)));
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		sink += (uintptr_t)copyString(stringChars, length);
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	resetHeap();
+	return time;
+}
+
+// Benchmark copying new strings of a length that must be interned.
+static uint64_t benchCopyStringNew(int length, long iterations) {
+	fillStringChars(length);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		writeStringNumber(length, i);
+		sink += (uintptr_t)copyString(stringChars, length);
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	resetHeap();
+	return time;
+}
+
+// Benchmark taking ownership of new strings of a length that must be
+// interned.
+static uint64_t benchTakeStringNew(int length, long iterations) {
+	fillStringChars(length);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		writeStringNumber(length, i);
+		char *chars = ALLOCATE(char, length + 1);
+		memcpy(chars, stringChars, (size_t)length + 1);
+		sink += (uintptr_t)takeString(chars, length);
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	resetHeap();
+	return time;
+}
+
+// Benchmark writing bytes to a chunk with a number of bytes per line.
+static uint64_t benchWriteChunk(int lineLength, long iterations) {
+	Chunk chunk;
+	initChunk(&chunk);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		writeChunk(&chunk, (uint8_t)i, (int)(i / lineLength) + 1);
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	sink += (uint64_t)chunk.count;
+	freeChunk(&chunk);
+	return time;
+}
+
+// Benchmark adding a new constant to a chunk with a number of constants.
+static uint64_t benchAddConstant(int count, long iterations) {
+	Chunk chunk;
+	initChunk(&chunk);
+	
+	for (int i = 0; i < count; i++) {
+		addConstant(&chunk, NUMBER_VAL(i));
+	}
+	
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		sink += (uint64_t)addConstant(&chunk, NUMBER_VAL(-1 - i));
+		chunk.constants.count--;
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	freeChunk(&chunk);
+	return time;
+}
+
+// Benchmark collecting garbage with a number of reachable strings.
+static uint64_t benchCollectStrings(int count, long iterations) {
+	for (int i = 0; i < count; i++) {
+		makeKey("string", i);
+	}
+	
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		collectAll();
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	resetHeap();
+	return time;
+}
+
+// Benchmark collecting garbage with a reachable linked list of a number of
+// instances.
+static uint64_t benchCollectList(int count, long iterations) {
+	ObjString *next = makeKey("next", 0);
+	ObjClass *klass = newClass(makeKey("Node", 0));
+	keepValue(OBJ_VAL(klass));
+	Value head = NIL_VAL;
+	
+	for (int i = 0; i < count; i++) {
+		ObjInstance *node = newInstance(klass);
+		tableSet(&node->fields, next, head);
+		head = OBJ_VAL(node);
+	}
+	
+	keepValue(head);
+	uint64_t start = getNanoseconds();
+	
+	for (long i = 0; i < iterations; i++) {
+		collectAll();
+	}
+	
+	uint64_t time = getNanoseconds() - start;
+	resetHeap();
+	return time;
+}
+
+// Benchmark collecting garbage with a number of unreachable strings.
+static uint64_t benchCollectGarbage(int count, long iterations) {
+	uint64_t time = 0;
+	
+	for (long i = 0; i < iterations; i++) {
+		for (int j = 0; j < count; j++) {
+			char chars[32];
+			int length = snprintf(chars, sizeof(chars), "garbage%d", j);
+			copyString(chars, length);
+		}
+		
+		uint64_t start = getNanoseconds();
+		collectAll();
+		time += getNanoseconds() - start;
+	}
+	
+	return time;
+}
+
+// The benchmarks.
+static const Benchmark benchmarks[] = {
+	{"table_get_hit", benchTableGetHit, 25},
+	{"table_get_hit", benchTableGetHit, 50},
+	{"table_get_hit", benchTableGetHit, 74},
+	{"table_get_miss", benchTableGetMiss, 25},
+	{"table_get_miss", benchTableGetMiss, 50},
+	{"table_get_miss", benchTableGetMiss, 74},
+	{"table_set", benchTableSet, 25},
+	{"table_set", benchTableSet, 50},
+	{"table_set", benchTableSet, 74},
+	{"table_delete_set", benchTableDelete, 25},
+	{"table_delete_set", benchTableDelete, 50},
+	{"table_delete_set", benchTableDelete, 74},
+	{"hash_string", benchHashString, 8},
+	{"hash_string", benchHashString, 64},
+	{"hash_string", benchHashString, 1024},
+	{"copy_string_hit", benchCopyStringHit, 8},
+	{"copy_string_hit", benchCopyStringHit, 64},
+	{"copy_string_new", benchCopyStringNew, 8},
+	{"copy_string_new", benchCopyStringNew, 64},
+	{"take_string_new", benchTakeStringNew, 8},
+	{"take_string_new", benchTakeStringNew, 64},
+	{"write_chunk", benchWriteChunk, 1},
+	{"write_chunk", benchWriteChunk, 16},
+	{"add_constant", benchAddConstant, 16},
+	{"add_constant", benchAddConstant, 256},
+	{"add_constant", benchAddConstant, 4096},
+	{"collect_strings", benchCollectStrings, 1000},
+	{"collect_strings", benchCollectStrings, 100000},
+	{"collect_list", benchCollectList, 1000},
+	{"collect_list", benchCollectList, 100000},
+	{"collect_garbage", benchCollectGarbage, 1000},
+	{"collect_garbage", benchCollectGarbage, 100000},
+};
+
+// Compare two doubles in ascending order.
+static int compareDoubles(const void *a, const void *b) {
+	double doubleA = *(const double*)a;
+	double doubleB = *(const double*)b;
+	return (doubleA > doubleB) - (doubleA < doubleB);
+}
+
+// Take samples of a benchmark's nanoseconds per operation with a number of
+// iterations, and return whether every sample took at least the minimum time.
+static bool takeSamples(const Benchmark *benchmark, long iterations, double *samples) {
+	bool isLongEnough = true;
+	
+	for (int i = 0; i < SAMPLE_COUNT; i++) {
+		uint64_t time = benchmark->function(benchmark->param, iterations);
+		isLongEnough = isLongEnough && time >= SAMPLE_MIN_TIME;
+		samples[i] = (double)time / (double)iterations;
+	}
+	
+	return isLongEnough;
+}
+
+// Run a benchmark in a fresh virtual machine and print its median nanoseconds
+// per operation and median absolute deviation.
+static void runBenchmark(const Benchmark *benchmark) {
+	initBenchmarkVM();
+	long iterations = 1;
+	
+	// The calibration runs also warm up the benchmark.
+	while (benchmark->function(benchmark->param, iterations) < SAMPLE_MIN_TIME) {
+		iterations *= 2;
+	}
+	
+	double samples[SAMPLE_COUNT];
+	double deviations[SAMPLE_COUNT];
+	
+	// A calibration run may have been slowed by noise, so the iterations grow
+	// until every sample takes the minimum time.
+	while (!takeSamples(benchmark, iterations, samples)) {
+		iterations *= 2;
+	}
+	
+	freeBenchmarkVM();
+	qsort(samples, SAMPLE_COUNT, sizeof(double), compareDoubles);
+	double median = samples[SAMPLE_COUNT / 2];
+	
+	for (int i = 0; i < SAMPLE_COUNT; i++) {
+		deviations[i] = samples[i] > median ? samples[i] - median : median - samples[i];
+	}
+	
+	qsort(deviations, SAMPLE_COUNT, sizeof(double), compareDoubles);
+	double deviation = median > 0 ? deviations[SAMPLE_COUNT / 2] / median * 100 : 0;
+	printf(
+			"%s\t%d\t%.3f\t%.3f\t%.1f\t%ld\n",
+			benchmark->name, benchmark->param, median, samples[0], deviation, iterations);
+	fflush(stdout);
+}
+
+// Run the benchmarks whose names contain an optional filter.
+int main(int argc, const char *argv[]) {
+	if (argc > 2) {
+		fprintf(stderr, "Usage: micro [filter]\n");
+		return 64;
+	}
+	
+	const char *filter = argc == 2 ? argv[1] : "";
+	
+#ifdef EXTENSIONS
+	initExtensions(0, NULL);
+#endif // EXTENSIONS
+	
+	printf("benchmark\tparam\tns_per_op\tmin_ns_per_op\tmad_pct\titerations\n");
+	
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(Benchmark); i++) {
+		if (strstr(benchmarks[i].name, filter) != NULL) {
+			runBenchmark(&benchmarks[i]);
+		}
+	}
+	
+#ifdef EXTENSIONS
+	freeExtensions();
+#endif // EXTENSIONS
+	
+	return 0;
+}
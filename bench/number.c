@@ -0,0 +1,176 @@
+// Clox Number Formatting Check
+// Check that numbers formatted by Clox read back as the same number for random
+// bit patterns in both exponent modes, then print the nanoseconds per number of
+// formatting them as tab-separated values.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "number.h"
+#include "timing.h"
+
+// The default number of random bit patterns to check in each exponent mode.
+#define CHECK_DEFAULT_COUNT 1000000
+
+// The number of random numbers formatted per throughput sample.
+#define SAMPLE_SIZE 100000
+
+// The number of throughput samples of each exponent mode.
+#define SAMPLE_COUNT 15
+
+// The maximum number of failures printed before the rest are only counted.
+#define FAILURES_PRINTED_MAX 10
+
+// The state of the random bit pattern generator.
+static uint64_t randomState = UINT64_C(0x9e3779b97f4a7c15);
+
+// The sink for benchmark results that must not be optimized away.
+static volatile uint64_t sink = 0;
+
+// The numbers that are checked before any random bit patterns.
+static const double edgeNumbers[] = {
+	0.0, -0.0, 1.0, -1.0, 0.1, 0.3, 1e-6, 1e-7, 1e21, 1e22, 1e23,
+	9007199254740991.0, 9007199254740992.0, 9007199254740993.0,
+	5e-324, 2.2250738585072009e-308, 2.2250738585072014e-308,
+	1.7976931348623157e308, 123456789012345680000.0, 0.000001234,
+};
+
+// Get the next random bit pattern using xorshift64*.
+static uint64_t nextRandom() {
+	randomState ^= randomState >> 12;
+	randomState ^= randomState << 25;
+	randomState ^= randomState >> 27;
+	return randomState * UINT64_C(2685821657736338717);
+}
+
+// Get a random finite number from a random bit pattern.
+static double nextNumber() {
+	for (;;) {
+		uint64_t bits = nextRandom();
+		double number;
+		memcpy(&number, &bits, sizeof(number));
+		
+		if (isfinite(number)) {
+			return number;
+		}
+	}
+}
+
+// Get whether two numbers have the same bit pattern.
+static bool isSameNumber(double a, double b) {
+	return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// Check that a number formatted in an exponent mode reads back as the same
+// number, and print it if it does not. Return whether it read back.
+static bool checkNumber(double number, bool isExponentAllowed, long failureCount) {
+	char buffer[NUMBER_BUFFER_SIZE];
+	int length = formatNumber(number, buffer, isExponentAllowed);
+	double result = strtod(buffer, NULL);
+	
+	if ((size_t)length == strlen(buffer) && isSameNumber(number, result)) {
+		return true;
+	}
+	
+	if (failureCount < FAILURES_PRINTED_MAX) {
+		fprintf(
+				stderr, "%.17g formatted as '%s' with exponents %s reads back as %.17g.\n",
+				number, buffer, isExponentAllowed ? "allowed" : "disallowed", result);
+	}
+	
+	return false;
+}
+
+// Check the edge numbers and a count of random bit patterns in an exponent
+// mode and return the number of failures.
+static long checkMode(bool isExponentAllowed, long count) {
+	long failureCount = 0;
+	
+	for (size_t i = 0; i < sizeof(edgeNumbers) / sizeof(double); i++) {
+		if (!checkNumber(edgeNumbers[i], isExponentAllowed, failureCount)) {
+			failureCount++;
+		}
+	}
+	
+	for (long i = 0; i < count; i++) {
+		if (!checkNumber(nextNumber(), isExponentAllowed, failureCount)) {
+			failureCount++;
+		}
+	}
+	
+	return failureCount;
+}
+
+// Compare two doubles in ascending order.
+static int compareDoubles(const void *a, const void *b) {
+	double doubleA = *(const double*)a;
+	double doubleB = *(const double*)b;
+	return (doubleA > doubleB) - (doubleA < doubleB);
+}
+
+// Get the median nanoseconds per number of formatting random numbers in an
+// exponent mode.
+static double timeMode(const double *numbers, bool isExponentAllowed) {
+	double samples[SAMPLE_COUNT];
+	char buffer[NUMBER_BUFFER_SIZE];
+	
+	for (int sample = 0; sample < SAMPLE_COUNT; sample++) {
+		uint64_t start = getNanoseconds();
+		
+		for (int i = 0; i < SAMPLE_SIZE; i++) {
+			sink += (uint64_t)formatNumber(numbers[i], buffer, isExponentAllowed);
+		}
+		
+		samples[sample] = (double)(getNanoseconds() - start) / SAMPLE_SIZE;
+	}
+	
+	qsort(samples, SAMPLE_COUNT, sizeof(double), compareDoubles);
+	return samples[SAMPLE_COUNT / 2];
+}
+
+// Check and time number formatting and return an exit status code.
+int main(int argc, const char *argv[]) {
+	long count = CHECK_DEFAULT_COUNT;
+	
+	if (argc > 2) {
+		fprintf(stderr, "Usage: number [count]\n");
+		return 64;
+	}
+	
+	if (argc == 2) {
+		char *end;
+		count = strtol(argv[1], &end, 10);
+		
+		if (*end != '\0' || count < 0) {
+			fprintf(stderr, "Count must be a non-negative integer.\n");
+			return 64;
+		}
+	}
+	
+	long failureCount = checkMode(true, count) + checkMode(false, count);
+	
+	if (failureCount > 0) {
+		fprintf(stderr, "%ld numbers did not read back.\n", failureCount);
+		return 1;
+	}
+	
+	double *numbers = (double*)malloc(sizeof(double) * SAMPLE_SIZE);
+	
+	if (numbers == NULL) {
+		return 1;
+	}
+	
+	for (int i = 0; i < SAMPLE_SIZE; i++) {
+		numbers[i] = nextNumber();
+	}
+	
+	long checkedCount = count + (long)(sizeof(edgeNumbers) / sizeof(double));
+	printf("mode\tchecked\tmedian_ns\n");
+	printf("exponent\t%ld\t%.3f\n", checkedCount, timeMode(numbers, true));
+	printf("decimal\t%ld\t%.3f\n", checkedCount, timeMode(numbers, false));
+	free(numbers);
+	return 0;
+}
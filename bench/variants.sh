@@ -0,0 +1,138 @@
+#!/bin/sh
+# Clox Variant Harness
+# Build Clox with every combination of its optional switches, run a corpus of
+# Lox programs and the Lynx bootstrap with each build, check that every build
+# produces the same output and exit status codes as the default build, and
+# report each build's speed from the fastest of several runs of each case.
+# Usage: variants.sh <cc> <cflags> <runs> <switch>...
+
+set -e
+
+if [ $# -lt 4 ]; then
+	echo "Usage: variants.sh <cc> <cflags> <runs> <switch>..." 1>&2
+	exit 64
+fi
+
+CC=$1
+CFLAGS=$2
+RUNS=$3
+shift 3
+SWITCHES=$*
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf -- "$WORK_DIR"' EXIT
+
+# Print every combination of turned off switches as variant names, starting
+# with the default build.
+variants() {
+	names="default"
+	
+	for switch in $SWITCHES; do
+		for name in $names; do
+			names="$names $name+NO_$switch"
+		done
+	done
+	
+	echo "$names" | sed 's/default+//g'
+}
+
+# Build a variant from its name.
+build() {
+	flags=""
+	
+	if [ "$1" != "default" ]; then
+		flags=$(echo "$1" | sed 's/^/-D/; s/+/ -D/g')
+	fi
+	
+	echo "Building variant '$1'..." 1>&2
+	$CC $CFLAGS $flags clox/*.c -o "$WORK_DIR/$1/clox" -lm
+}
+
+# Run a case of the corpus with a variant several times from the variant's
+# name, the case's name, and Clox arguments, and record its output, exit status
+# code, and fastest time.
+run() {
+	variant=$1
+	name=$2
+	shift 2
+	dir="$WORK_DIR/$variant/$name"
+	mkdir -p "$dir"
+	: > "$dir/times"
+	
+	for i in $(seq "$RUNS"); do
+		status=0
+		"$WORK_DIR/$variant/clox" --vm-stats "$dir/stats.tsv" "$@" \
+			> "$dir/stdout" 2> "$dir/stderr" || status=$?
+		echo "$status" > "$dir/status"
+		awk '$1 == "elapsed_ms" { print $2 }' "$dir/stats.tsv" >> "$dir/times"
+	done
+	
+	sort -n "$dir/times" | head -n 1 >> "$WORK_DIR/$variant/times"
+}
+
+# Run the corpus with a variant from its name.
+corpus() {
+	out="$WORK_DIR/$1"
+	: > "$out/times"
+	
+	for script in bench/*.lox; do
+		name=$(basename "$script" .lox)
+		mkdir -p "$WORK_DIR/scratch/$1/$name"
+		run "$1" "$name" "$script" "$WORK_DIR/scratch/$1/$name"
+	done
+	
+	run "$1" merge utils/merge.lox lynx/merge.txt std "$out/lynx_stage_0.lox"
+	run "$1" stage_1 "$out/lynx_stage_0.lox" --std std --output "$out/lynx_stage_1.lox" -- lynx/main.lox
+	run "$1" stage_2 "$out/lynx_stage_1.lox" --std std --output "$out/lynx_stage_2.lox" -- lynx/main.lox
+	run "$1" lynx_usage "$out/lynx_stage_2.lox"
+	run "$1" compare utils/compare.lox "$out/lynx_stage_1.lox" "$out/lynx_stage_2.lox"
+}
+
+VARIANTS=$(variants)
+failures=0
+
+for variant in $VARIANTS; do
+	mkdir -p "$WORK_DIR/$variant"
+	build "$variant"
+	echo "Running corpus with variant '$variant'..." 1>&2
+	corpus "$variant"
+done
+
+printf '%-56s %12s %8s\n' "variant" "total_ms" "speed"
+base=$(awk '{ total += $1 } END { print total }' "$WORK_DIR/default/times")
+
+for variant in $VARIANTS; do
+	differences=$failures
+	
+	for dir in "$WORK_DIR/default"/*/; do
+		name=$(basename "$dir")
+		
+		for file in stdout stderr status; do
+			if ! cmp -s "$dir/$file" "$WORK_DIR/$variant/$name/$file"; then
+				echo "Variant '$variant' differs in $file of '$name'." 1>&2
+				failures=$((failures + 1))
+			fi
+		done
+	done
+	
+	for file in lynx_stage_1.lox lynx_stage_2.lox; do
+		if ! cmp -s "$WORK_DIR/default/$file" "$WORK_DIR/$variant/$file"; then
+			echo "Variant '$variant' differs in '$file'." 1>&2
+			failures=$((failures + 1))
+		fi
+	done
+	
+	if [ "$failures" -ne "$differences" ]; then
+		printf '%-56s %12s %8s\n' "$variant" "-" "failed"
+		continue
+	fi
+	
+	awk -v variant="$variant" -v base="$base" '
+		{ total += $1 }
+		END { printf "%-56s %12.3f %7.2fx\n", variant, total, base / total }
+	' "$WORK_DIR/$variant/times"
+done
+
+if [ "$failures" -ne 0 ]; then
+	echo "$failures differences found." 1>&2
+	exit 1
+fi
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocstats.h"
+#include "indices.h"
+#include "memory.h"
+#include "vm.h"
+
+// The number of object types.
+#define OBJ_TYPE_COUNT (OBJ_UPVALUE + 1)
+
+// The number of allocation sites to print.
+#define ALLOCATION_SITE_MAX 30
+
+// A call site's allocation statistics.
+typedef struct {
+	// The site's function, or `NULL` for allocations outside of calls.
+	Obj *function;
+	
+	// The site's function name.
+	char *name;
+	
+	// The site's line.
+	int line;
+	
+	// The number of bytes allocated by the site.
+	uint64_t bytes;
+	
+	// The number of objects allocated by the site.
+	uint64_t objects;
+	
+	// The number of objects allocated by the site that survived a garbage
+	// collection.
+	uint64_t survivors;
+	
+	// The number of objects of each type allocated by the site.
+	uint64_t typeCounts[OBJ_TYPE_COUNT];
+} AllocationSite;
+
+// An object that has not survived a garbage collection yet.
+typedef struct {
+	// The young object.
+	Obj *object;
+	
+	// The index of the call site that allocated the object.
+	int siteIndex;
+} YoungObject;
+
+bool isRecordingAllocations = false;
+
+// The allocation statistics of each call site.
+static AllocationSite *allocationSites = NULL;
+
+// The number of call sites that allocated.
+static int allocationSiteCount = 0;
+
+// The current maximum number of call sites that allocated.
+static int allocationSiteCapacity = 0;
+
+// The indices into the allocation statistics by call site function and line.
+static IndexTable siteIndices;
+
+// The index of the last call site that allocated, or `-1` if there is none.
+static int lastSiteIndex = -1;
+
+// The objects allocated since the last garbage collection.
+static YoungObject *youngObjects = NULL;
+
+// The number of objects allocated since the last garbage collection.
+static int youngObjectCount = 0;
+
+// The current maximum number of objects allocated since the last garbage
+// collection.
+static int youngObjectCapacity = 0;
+
+// The number of surviving objects of each type.
+static uint64_t typeSurvivors[OBJ_TYPE_COUNT];
+
+// Get the index of a call site's allocation statistics, adding them if they
+// do not exist.
+static int getSiteIndex(Obj *function, int line) {
+	int index = indexTableGet(&siteIndices, function, line);
+	
+	if (index != -1) {
+		return index;
+	}
+	
+	if (allocationSiteCapacity < allocationSiteCount + 1) {
+		allocationSiteCapacity = allocationSiteCapacity < 64 ? 64 : allocationSiteCapacity * 2;
+		allocationSites = (AllocationSite*)realloc(
+				allocationSites, sizeof(AllocationSite) * (size_t)allocationSiteCapacity);
+		
+		if (allocationSites == NULL) {
+			exit(1);
+		}
+	}
+	
+	AllocationSite *site = &allocationSites[allocationSiteCount];
+	memset(site, 0, sizeof(AllocationSite));
+	site->function = function;
+	site->line = line;
+	
+	if (function != NULL) {
+		site->name = copyFunctionName(function);
+	} else {
+		site->name = (char*)malloc(sizeof("<vm>"));
+		
+		if (site->name == NULL) {
+			exit(1);
+		}
+		
+		memcpy(site->name, "<vm>", sizeof("<vm>"));
+	}
+	
+	indexTableAdd(&siteIndices, function, line, allocationSiteCount);
+	return allocationSiteCount++;
+}
+
+// Get the index of the current call site's allocation statistics.
+static int getCurrentSiteIndex() {
+	Obj *function = NULL;
+	int line = 0;
+	
+	if (vm.frameCount > 0) {
+		CallFrame *frame = &vm.frames[vm.frameCount - 1];
+		Chunk *chunk = &frame->closure->function->chunk;
+		function = (Obj*)frame->closure->function;
+		line = getLine(chunk, (int)(frame->ip - chunk->code) - 1);
+	}
+	
+	// Consecutive allocations usually come from the same call site.
+	if (lastSiteIndex != -1) {
+		AllocationSite *site = &allocationSites[lastSiteIndex];
+		
+		if (site->function == function && site->line == line) {
+			return lastSiteIndex;
+		}
+	}
+	
+	lastSiteIndex = getSiteIndex(function, line);
+	return lastSiteIndex;
+}
+
+// Get an object type's name.
+static const char *getTypeName(int type) {
+	switch (type) {
+		case OBJ_ARRAY: return "array";
+		case OBJ_BOUND_METHOD: return "bound method";
+		case OBJ_CLASS: return "class";
+		case OBJ_CLOSURE: return "closure";
+		case OBJ_FUNCTION: return "function";
+		case OBJ_INSTANCE: return "instance";
+		case OBJ_MAP: return "map";
+		case OBJ_NATIVE: return "native";
+		case OBJ_STRING: return "string";
+		case OBJ_STRING_BUILDER: return "string builder";
+		case OBJ_UPVALUE: return "upvalue";
+		default: return "unknown";
+	}
+}
+
+// Compare two call sites' allocation statistics by their allocated bytes in
+// descending order.
+static int compareAllocationSites(const void *a, const void *b) {
+	uint64_t bytesA = ((const AllocationSite*)a)->bytes;
+	uint64_t bytesB = ((const AllocationSite*)b)->bytes;
+	return (bytesA < bytesB) - (bytesA > bytesB);
+}
+
+// Print the allocation statistics to the standard error stream and free them.
+static void printAllocationStats() {
+	isRecordingAllocations = false;
+	flushOutput();
+	
+	uint64_t bytes = 0;
+	uint64_t typeCounts[OBJ_TYPE_COUNT] = {0};
+	
+	for (int i = 0; i < allocationSiteCount; i++) {
+		bytes += allocationSites[i].bytes;
+		
+		for (int type = 0; type < OBJ_TYPE_COUNT; type++) {
+			typeCounts[type] += allocationSites[i].typeCounts[type];
+		}
+	}
+	
+	qsort(allocationSites, (size_t)allocationSiteCount, sizeof(AllocationSite), compareAllocationSites);
+	
+	fprintf(stderr, "== allocation stats ==\n");
+	fprintf(stderr, "%-32s %8s %14s %12s %12s  %s\n", "site", "line", "bytes", "objects", "survivors", "types");
+	
+	for (int i = 0; i < allocationSiteCount && i < ALLOCATION_SITE_MAX; i++) {
+		AllocationSite *site = &allocationSites[i];
+		fprintf(
+				stderr, "%-32s %8d %14llu %12llu %12llu ",
+				site->name, site->line, (unsigned long long)site->bytes,
+				(unsigned long long)site->objects, (unsigned long long)site->survivors);
+		
+		for (int type = 0; type < OBJ_TYPE_COUNT; type++) {
+			if (site->typeCounts[type] > 0) {
+				fprintf(stderr, " %s %llu", getTypeName(type), (unsigned long long)site->typeCounts[type]);
+			}
+		}
+		
+		fprintf(stderr, "\n");
+	}
+	
+	fprintf(stderr, "%-32s %8s %14llu\n", "total", "", (unsigned long long)bytes);
+	fprintf(stderr, "== allocation stats by type ==\n");
+	fprintf(stderr, "%-32s %12s %12s\n", "type", "objects", "survivors");
+	
+	for (int type = 0; type < OBJ_TYPE_COUNT; type++) {
+		if (typeCounts[type] > 0) {
+			fprintf(
+					stderr, "%-32s %12llu %12llu\n",
+					getTypeName(type), (unsigned long long)typeCounts[type], (unsigned long long)typeSurvivors[type]);
+		}
+	}
+	
+	for (int i = 0; i < allocationSiteCount; i++) {
+		free(allocationSites[i].name);
+	}
+	
+	free(allocationSites);
+	freeIndexTable(&siteIndices);
+	free(youngObjects);
+	allocationSites = NULL;
+	allocationSiteCount = 0;
+	allocationSiteCapacity = 0;
+	lastSiteIndex = -1;
+	youngObjects = NULL;
+	youngObjectCount = 0;
+	youngObjectCapacity = 0;
+}
+
+void initAllocationStats() {
+	isRecordingAllocations = true;
+	atexit(printAllocationStats);
+}
+
+void recordBytes(size_t bytes) {
+	int siteIndex = getCurrentSiteIndex();
+	allocationSites[siteIndex].bytes += bytes;
+}
+
+void recordObject(Obj *object) {
+	int siteIndex = getCurrentSiteIndex();
+	AllocationSite *site = &allocationSites[siteIndex];
+	site->objects++;
+	site->typeCounts[object->type]++;
+	
+	if (youngObjectCapacity < youngObjectCount + 1) {
+		youngObjectCapacity = youngObjectCapacity < 256 ? 256 : youngObjectCapacity * 2;
+		youngObjects = (YoungObject*)realloc(youngObjects, sizeof(YoungObject) * (size_t)youngObjectCapacity);
+		
+		if (youngObjects == NULL) {
+			exit(1);
+		}
+	}
+	
+	YoungObject *young = &youngObjects[youngObjectCount++];
+	young->object = object;
+	young->siteIndex = siteIndex;
+}
+
+void recordSurvivors() {
+	// Every young object is either marked and survives, or is about to be
+	// swept, so none of them are young after this collection.
+	for (int i = 0; i < youngObjectCount; i++) {
+		YoungObject *young = &youngObjects[i];
+		
+		if (young->object->isMarked) {
+			allocationSites[young->siteIndex].survivors++;
+			typeSurvivors[young->object->type]++;
+		}
+	}
+	
+	youngObjectCount = 0;
+}
+
+void markAllocationStatsRoots() {
+	for (int i = 0; i < allocationSiteCount; i++) {
+		markObject(allocationSites[i].function);
+	}
+}
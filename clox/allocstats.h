@@ -0,0 +1,27 @@
+#ifndef clox_allocstats_h
+#define clox_allocstats_h
+
+#include "common.h"
+#include "object.h"
+
+// Whether allocation statistics are being recorded.
+extern bool isRecordingAllocations;
+
+// Start recording allocation statistics to print at exit.
+void initAllocationStats();
+
+// Record a number of bytes allocated by the current call site.
+void recordBytes(size_t bytes);
+
+// Record an object allocated by the current call site.
+void recordObject(Obj *object);
+
+// Record which objects allocated since the last garbage collection survived
+// it. This must be called after marking and before sweeping.
+void recordSurvivors();
+
+// Mark the functions of call sites that allocated as reachable so that their
+// objects are never reused.
+void markAllocationStatsRoots();
+
+#endif // !clox_allocstats_h
@@ -8,13 +8,15 @@ void initChunk(Chunk *chunk) {
 	chunk->count = 0;
 	chunk->capacity = 0;
 	chunk->code = NULL;
+	chunk->lineCount = 0;
+	chunk->lineCapacity = 0;
 	chunk->lines = NULL;
 	initValueArray(&chunk->constants);
 }
 
 void freeChunk(Chunk *chunk) {
 	FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
-	FREE_ARRAY(int, chunk->lines, chunk->capacity);
+	FREE_ARRAY(LineStart, chunk->lines, chunk->lineCapacity);
 	freeValueArray(&chunk->constants);
 	initChunk(chunk);
 }
@@ -24,12 +26,24 @@ void writeChunk(Chunk *chunk, uint8_t byte, int line) {
 		int oldCapacity = chunk->capacity;
 		chunk->capacity = GROW_CAPACITY(oldCapacity);
 		chunk->code = GROW_ARRAY(uint8_t, chunk->code, oldCapacity, chunk->capacity);
-		chunk->lines = GROW_ARRAY(int, chunk->lines, oldCapacity, chunk->capacity);
 	}
 	
 	chunk->code[chunk->count] = byte;
-	chunk->lines[chunk->count] = line;
 	chunk->count++;
+	
+	if (chunk->lineCount > 0 && chunk->lines[chunk->lineCount - 1].line == line) {
+		return; // Extend the current line run.
+	}
+	
+	if (chunk->lineCapacity < chunk->lineCount + 1) {
+		int oldCapacity = chunk->lineCapacity;
+		chunk->lineCapacity = GROW_CAPACITY(oldCapacity);
+		chunk->lines = GROW_ARRAY(LineStart, chunk->lines, oldCapacity, chunk->lineCapacity);
+	}
+	
+	LineStart *lineStart = &chunk->lines[chunk->lineCount++];
+	lineStart->offset = chunk->count - 1;
+	lineStart->line = line;
 }
 
 int addConstant(Chunk *chunk, Value value) {
@@ -48,3 +62,21 @@ int addConstant(Chunk *chunk, Value value) {
 	pop();
 	return chunk->constants.count - 1;
 }
+
+int getLine(Chunk *chunk, int offset) {
+	int start = 0;
+	int end = chunk->lineCount - 1;
+	
+	// Find the last line run starting at or before the offset.
+	while (start < end) {
+		int mid = start + (end - start + 1) / 2;
+		
+		if (chunk->lines[mid].offset > offset) {
+			end = mid - 1;
+		} else {
+			start = mid;
+		}
+	}
+	
+	return chunk->lineCount > 0 ? chunk->lines[start].line : 0;
+}
@@ -22,6 +22,12 @@ typedef uint8_t ConstantIndex;
 
 #endif // !LONG_CONSTANTS
 
+// An upvalue operand flag for capturing a local instead of an upvalue.
+#define UPVALUE_LOCAL 1
+
+// An upvalue operand flag for a 16-bit index instead of an 8-bit index.
+#define UPVALUE_LONG 2
+
 // A bytecode instruction's type.
 typedef enum {
 	// Push a constant value to the stack from its index.
@@ -42,9 +48,15 @@ typedef enum {
 	// Push a local to the stack from a stack slot.
 	OP_GET_LOCAL,
 	
+	// Push a local to the stack from a 16-bit stack slot.
+	OP_GET_LOCAL_LONG,
+	
 	// Peek the top value of the stack and set a local from a stack slot.
 	OP_SET_LOCAL,
 	
+	// Peek the top value of the stack and set a local from a 16-bit stack slot.
+	OP_SET_LOCAL_LONG,
+	
 	// Push a global to the stack from a constant.
 	OP_GET_GLOBAL,
 	
@@ -57,9 +69,16 @@ typedef enum {
 	// Push an upvalue to the stack from an upvalue slot.
 	OP_GET_UPVALUE,
 	
+	// Push an upvalue to the stack from a 16-bit upvalue slot.
+	OP_GET_UPVALUE_LONG,
+	
 	// Peek the top value of the stack and set an upvalue from an upvalue slot.
 	OP_SET_UPVALUE,
 	
+	// Peek the top value of the stack and set an upvalue from a 16-bit upvalue
+	// slot.
+	OP_SET_UPVALUE_LONG,
+	
 	// Replace the top instance value of the stack with a field from a constant.
 	OP_GET_PROPERTY,
 	
@@ -111,13 +130,27 @@ typedef enum {
 	// Call an argument list with a number of arguments.
 	OP_CALL,
 	
+	// Call an argument list with a number of arguments where the callee is
+	// expected to be a native.
+	OP_CALL_NATIVE,
+	
+	// Call an argument list with a number of arguments in place of the current
+	// function.
+	OP_TAIL_CALL,
+	
 	// Invoke a method call with a name constant and number of arguments.
 	OP_INVOKE,
 	
+	// Invoke a method call with a name constant and number of arguments in
+	// place of the current function.
+	OP_TAIL_INVOKE,
+	
 	// Invoke a super method with a name constant and number of arguments.
 	OP_SUPER_INVOKE,
 	
 	// Push a closure value to the stack from a function constant and upvalues.
+	// Each upvalue is an `UPVALUE_*` flags byte followed by an 8-bit index, or
+	// a 16-bit index if the `UPVALUE_LONG` flag is set.
 	OP_CLOSURE,
 	
 	// Pop the top value from the stack and close it in an upvalue.
@@ -136,6 +169,15 @@ typedef enum {
 	OP_METHOD,
 } OpCode;
 
+// A run of bytecode bytes on the same line.
+typedef struct {
+	// The offset of the line run's first byte.
+	int offset;
+	
+	// The line run's line.
+	int line;
+} LineStart;
+
 // A chunk of bytecode for a script.
 typedef struct {
 	// The number of bytes in the chunk's bytecode.
@@ -147,8 +189,14 @@ typedef struct {
 	// The chunk's bytecode.
 	uint8_t *code;
 	
-	// The chunk's lines at each bytecode offset.
-	int *lines;
+	// The number of line runs in the chunk.
+	int lineCount;
+	
+	// The current maximum number of line runs in the chunk.
+	int lineCapacity;
+	
+	// The chunk's line runs in bytecode offset order.
+	LineStart *lines;
 	
 	// The chunk's constant values.
 	ValueArray constants;
@@ -166,4 +214,7 @@ void writeChunk(Chunk *chunk, uint8_t byte, int line);
 // Add a new constant value to a chunk and return its index.
 int addConstant(Chunk *chunk, Value value);
 
+// Get the line of a bytecode offset in a chunk.
+int getLine(Chunk *chunk, int offset);
+
 #endif // !clox_chunk_h
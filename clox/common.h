@@ -5,20 +5,28 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// The default switches below can each be turned off without editing this file
+// by defining `NO_<switch>`, such as with `-DNO_NAN_BOXING`.
+
 // Use a smaller value representation.
+#ifndef NO_NAN_BOXING
 #define NAN_BOXING
+#endif // !NO_NAN_BOXING
 
 // Use non-standard native extension functions.
+#ifndef NO_EXTENSIONS
 #define EXTENSIONS
+#endif // !NO_EXTENSIONS
 
 // Merge constant indices for constants with equal values.
+#ifndef NO_CONSTANT_MERGING
 #define CONSTANT_MERGING
+#endif // !NO_CONSTANT_MERGING
 
 // Use 16-bit constant indices.
+#ifndef NO_LONG_CONSTANTS
 #define LONG_CONSTANTS
-
-// Use a maximum function call depth of 128.
-#define DEEP_CALLS
+#endif // !NO_LONG_CONSTANTS
 
 // Disassemble bytecode after compilation.
 //#define DEBUG_PRINT_CODE
@@ -32,7 +40,14 @@
 // Log garbage collection information.
 //#define DEBUG_LOG_GC
 
+// Count and sample the timing of executed opcodes, and print statistics at
+// exit.
+//#define DEBUG_OPCODE_STATS
+
 // The number of unique 8-bit unsigned integers.
 #define UINT8_COUNT (UINT8_MAX + 1)
 
+// The number of unique 16-bit unsigned integers.
+#define UINT16_COUNT (UINT16_MAX + 1)
+
 #endif // !clox_common_h
@@ -92,7 +92,7 @@ typedef struct {
 // An upvalue in the compiling function.
 typedef struct {
 	// The upvalue's slot index.
-	uint8_t index;
+	uint16_t index;
 	
 	// Whether the upvalue points to a parent function's local.
 	bool isLocal;
@@ -125,16 +125,31 @@ typedef struct Compiler {
 	FunctionType type;
 	
 	// The current defined locals on the stack.
-	Local locals[UINT8_COUNT];
+	Local *locals;
 	
 	// The number of locals in scope.
 	int localCount;
 	
+	// The current maximum number of locals in scope.
+	int localCapacity;
+	
 	// The upvalues used by the compiling function.
-	Upvalue upvalues[UINT8_COUNT];
+	Upvalue *upvalues;
+	
+	// The current maximum number of upvalues used by the compiling function.
+	int upvalueCapacity;
 	
 	// The current scope depth.
 	int scopeDepth;
+	
+	// The offset of the last emitted call instruction.
+	int callOffset;
+	
+	// The offset after the last emitted call instruction.
+	int callEnd;
+	
+	// The offset after the last emitted get of a native global.
+	int nativeEnd;
 } Compiler;
 
 // A compiler for containing the class compilation state.
@@ -237,6 +252,12 @@ static void emitBytes(uint8_t byte1, uint8_t byte2) {
 	emitByte(byte2);
 }
 
+// Emit a big-endian 16-bit unsigned integer.
+static void emitShort(uint16_t value) {
+	emitByte((value >> 8) & 0xff);
+	emitByte(value & 0xff);
+}
+
 // Emit a loop instruction to a start offset.
 static void emitLoop(int loopStart) {
 	emitByte(OP_LOOP);
@@ -294,8 +315,9 @@ static void emitConstantIndex(ConstantIndex constant) {
 
 // Emit a constant instruction.
 static void emitConstant(Value value) {
+	ConstantIndex constant = makeConstant(value); // Root value before emitting.
 	emitByte(OP_CONSTANT);
-	emitConstantIndex(makeConstant(value));
+	emitConstantIndex(constant);
 }
 
 // Patch a jump instruction's operand to the current offset.
@@ -310,21 +332,46 @@ static void patchJump(int offset) {
 	currentChunk()->code[offset + 1] = jump & 0xff;
 }
 
+// Push a new local to a compiler's locals and return it.
+static Local *pushLocal(Compiler *compiler) {
+	if (compiler->localCapacity < compiler->localCount + 1) {
+		int oldCapacity = compiler->localCapacity;
+		compiler->localCapacity = GROW_CAPACITY(oldCapacity);
+		compiler->locals = GROW_ARRAY(Local, compiler->locals, oldCapacity, compiler->localCapacity);
+	}
+	
+	Local *local = &compiler->locals[compiler->localCount++];
+	
+	if (compiler->localCount > compiler->function->slotCount) {
+		compiler->function->slotCount = compiler->localCount;
+	}
+	
+	return local;
+}
+
 // Initialize a new current compiler.
 static void initCompiler(Compiler *compiler, FunctionType type) {
 	compiler->enclosing = current;
 	compiler->function = NULL;
 	compiler->type = type;
+	compiler->locals = NULL;
 	compiler->localCount = 0;
+	compiler->localCapacity = 0;
+	compiler->upvalues = NULL;
+	compiler->upvalueCapacity = 0;
 	compiler->scopeDepth = 0;
+	compiler->callOffset = -1;
+	compiler->callEnd = -1;
+	compiler->nativeEnd = -1;
 	compiler->function = newFunction();
 	current = compiler;
 	
 	if (type != TYPE_SCRIPT) {
 		current->function->name = copyString(parser.previous.start, parser.previous.length);
+		current->function->line = parser.previous.line;
 	}
 	
-	Local *local = &current->locals[current->localCount++];
+	Local *local = pushLocal(current);
 	local->depth = 0;
 	local->isCaptured = false;
 	
@@ -353,6 +400,12 @@ static ObjFunction *endCompiler() {
 	return function;
 }
 
+// Free a compiler's locals and upvalues after it has ended.
+static void freeCompiler(Compiler *compiler) {
+	FREE_ARRAY(Local, compiler->locals, compiler->localCapacity);
+	FREE_ARRAY(Upvalue, compiler->upvalues, compiler->upvalueCapacity);
+}
+
 // Begin a new current scope.
 static void beginScope() {
 	current->scopeDepth++;
@@ -423,7 +476,7 @@ static int resolveLocal(Compiler *compiler, Token *name) {
 }
 
 // Add an upvalue to a compiling function and return its upvalue slot.
-static int addUpvalue(Compiler *compiler, uint8_t index, bool isLocal) {
+static int addUpvalue(Compiler *compiler, uint16_t index, bool isLocal) {
 	int upvalueCount = compiler->function->upvalueCount;
 	
 	for (int i = 0; i < upvalueCount; i++) {
@@ -434,11 +487,18 @@ static int addUpvalue(Compiler *compiler, uint8_t index, bool isLocal) {
 		}
 	}
 	
-	if (upvalueCount == UINT8_COUNT) {
+	if (upvalueCount == UINT16_COUNT) {
 		error("Too many closure variables in function.");
 		return 0;
 	}
 	
+	if (compiler->upvalueCapacity < upvalueCount + 1) {
+		int oldCapacity = compiler->upvalueCapacity;
+		compiler->upvalueCapacity = GROW_CAPACITY(oldCapacity);
+		compiler->upvalues = GROW_ARRAY(
+				Upvalue, compiler->upvalues, oldCapacity, compiler->upvalueCapacity);
+	}
+	
 	compiler->upvalues[upvalueCount].isLocal = isLocal;
 	compiler->upvalues[upvalueCount].index = index;
 	return compiler->function->upvalueCount++;
@@ -454,13 +514,13 @@ static int resolveUpvalue(Compiler *compiler, Token *name) {
 	
 	if (local != -1) {
 		compiler->enclosing->locals[local].isCaptured = true;
-		return addUpvalue(compiler, (uint8_t)local, true);
+		return addUpvalue(compiler, (uint16_t)local, true);
 	}
 	
 	int upvalue = resolveUpvalue(compiler->enclosing, name);
 	
 	if (upvalue != -1) {
-		return addUpvalue(compiler, (uint8_t)upvalue, false);
+		return addUpvalue(compiler, (uint16_t)upvalue, false);
 	}
 	
 	return -1;
@@ -468,12 +528,12 @@ static int resolveUpvalue(Compiler *compiler, Token *name) {
 
 // Track a local declaration.
 static void addLocal(Token name) {
-	if (current->localCount == UINT8_COUNT) {
+	if (current->localCount == UINT16_COUNT) {
 		error("Too many local variables in function.");
 		return;
 	}
 	
-	Local *local = &current->locals[current->localCount++];
+	Local *local = pushLocal(current);
 	local->name = name;
 	local->depth = -1; // The local has not finished being initialized.
 	local->isCaptured = false;
@@ -562,11 +622,11 @@ static void namedVariable(Token name, bool canAssign) {
 	bool isConstant = false;
 	
 	if (arg != -1) {
-		getOp = OP_GET_LOCAL;
-		setOp = OP_SET_LOCAL;
+		getOp = arg > UINT8_MAX ? OP_GET_LOCAL_LONG : OP_GET_LOCAL;
+		setOp = arg > UINT8_MAX ? OP_SET_LOCAL_LONG : OP_SET_LOCAL;
 	} else if ((arg = resolveUpvalue(current, &name)) != -1) {
-		getOp = OP_GET_UPVALUE;
-		setOp = OP_SET_UPVALUE;
+		getOp = arg > UINT8_MAX ? OP_GET_UPVALUE_LONG : OP_GET_UPVALUE;
+		setOp = arg > UINT8_MAX ? OP_SET_UPVALUE_LONG : OP_SET_UPVALUE;
 	} else {
 		arg = identifierConstant(&name);
 		isConstant = true;
@@ -574,7 +634,9 @@ static void namedVariable(Token name, bool canAssign) {
 		setOp = OP_SET_GLOBAL;
 	}
 	
-	if (canAssign && match(TOKEN_EQUAL)) {
+	bool isSet = canAssign && match(TOKEN_EQUAL);
+	
+	if (isSet) {
 		expression();
 		emitByte(setOp);
 	} else {
@@ -583,9 +645,15 @@ static void namedVariable(Token name, bool canAssign) {
 	
 	if (isConstant) {
 		emitConstantIndex((ConstantIndex)arg);
+	} else if (arg > UINT8_MAX) {
+		emitShort((uint16_t)arg);
 	} else {
 		emitByte((uint8_t)arg);
 	}
+	
+	if (!isSet && isConstant && name.length > 2 && memcmp(name.start, "__", 2) == 0) {
+		current->nativeEnd = currentChunk()->count;
+	}
 }
 
 // Compile a variable set or get expression.
@@ -669,8 +737,17 @@ static void binary(bool canAssign) {
 static void call(bool canAssign) {
 	(void)canAssign; // Unused parameter.
 	
+	// Calls to native globals are not tail calls because they do not use a
+	// call frame.
+	if (current->nativeEnd == currentChunk()->count) {
+		emitBytes(OP_CALL_NATIVE, argumentList());
+		return;
+	}
+	
 	uint8_t argCount = argumentList();
+	current->callOffset = currentChunk()->count;
 	emitBytes(OP_CALL, argCount);
+	current->callEnd = currentChunk()->count;
 }
 
 // Compile a dot expression.
@@ -684,9 +761,11 @@ static void dot(bool canAssign) {
 		emitConstantIndex(name);
 	} else if (match(TOKEN_LEFT_PAREN)) {
 		uint8_t argCount = argumentList();
+		current->callOffset = currentChunk()->count;
 		emitByte(OP_INVOKE);
 		emitConstantIndex(name);
 		emitByte(argCount);
+		current->callEnd = currentChunk()->count;
 	} else {
 		emitByte(OP_GET_PROPERTY);
 		emitConstantIndex(name);
@@ -879,13 +958,24 @@ static void function(FunctionType type) {
 	block();
 	
 	ObjFunction *function = endCompiler();
+	ConstantIndex constant = makeConstant(OBJ_VAL(function)); // Root function before emitting.
 	emitByte(OP_CLOSURE);
-	emitConstantIndex(makeConstant(OBJ_VAL(function)));
+	emitConstantIndex(constant);
 	
 	for (int i = 0; i < function->upvalueCount; i++) {
-		emitByte(compiler.upvalues[i].isLocal ? 1 : 0);
-		emitByte(compiler.upvalues[i].index);
+		uint16_t index = compiler.upvalues[i].index;
+		uint8_t flags = compiler.upvalues[i].isLocal ? UPVALUE_LOCAL : 0;
+		
+		if (index > UINT8_MAX) {
+			emitByte(flags | UPVALUE_LONG);
+			emitShort(index);
+		} else {
+			emitByte(flags);
+			emitByte((uint8_t)index);
+		}
 	}
+	
+	freeCompiler(&compiler);
 }
 
 // Compile a method declaration.
@@ -1070,6 +1160,14 @@ static void returnStatement() {
 		
 		expression();
 		consume(TOKEN_SEMICOLON, "Expect ';' after return value.");
+		
+		// Replace a call that ends the return value with a tail call. The
+		// return is still emitted for any jumps that skip the call.
+		if (current->callEnd == currentChunk()->count) {
+			uint8_t *code = &currentChunk()->code[current->callOffset];
+			*code = *code == OP_CALL ? OP_TAIL_CALL : OP_TAIL_INVOKE;
+		}
+		
 		emitByte(OP_RETURN);
 	}
 }
@@ -1169,7 +1267,8 @@ ObjFunction *compile(const char *source) {
 		declaration();
 	}
 	
-	ObjFunction *function = endCompiler();	
+	ObjFunction *function = endCompiler();
+	freeCompiler(&compiler);
 	return parser.hadError ? NULL : function;
 }
 
@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coverage.h"
+#include "indices.h"
+#include "memory.h"
+#include "vm.h"
+
+// The number of hot lines to print.
+#define HOT_LINE_MAX 50
+
+// A function's execution counts for coverage.
+typedef struct {
+	// The covered function.
+	ObjFunction *function;
+	
+	// The function's name, copied so that it can be written after the
+	// function is freed.
+	char *name;
+	
+	// The line the function was declared on.
+	int line;
+	
+	// The number of bytes in the function's bytecode.
+	int count;
+	
+	// The line of each byte in the function's bytecode, copied so that they
+	// can be written after the function is freed.
+	int *lines;
+	
+	// The number of times each instruction was executed by its offset.
+	uint64_t *hits;
+} FunctionCoverage;
+
+// A source line's execution counts for coverage.
+typedef struct {
+	// The line's number.
+	int line;
+	
+	// The number of times the line was executed, which is the greatest number
+	// of times any of its instructions were executed.
+	uint64_t hits;
+	
+	// The number of instructions executed on the line.
+	uint64_t instructions;
+	
+	// Whether the line contains any instructions.
+	bool hasCode;
+} LineCoverage;
+
+bool isRecordingCoverage = false;
+
+// The file to write coverage to at exit.
+static FILE *coverageFile = NULL;
+
+// The path of the covered source file.
+static const char *coverageSourcePath = NULL;
+
+// The execution counts of each covered function.
+static FunctionCoverage *functionCoverages = NULL;
+
+// The number of covered functions.
+static int functionCoverageCount = 0;
+
+// The current maximum number of covered functions.
+static int functionCoverageCapacity = 0;
+
+// The indices into the function coverages by function.
+static IndexTable coverageIndices;
+
+// The index of the last executed function's coverage, or `-1` if there is
+// none.
+static int lastCoverageIndex = -1;
+
+// Get the index of a function's coverage, adding it and the coverage of the
+// functions it declares if they do not exist.
+static int getCoverageIndex(ObjFunction *function) {
+	int index = indexTableGet(&coverageIndices, function, 0);
+	
+	if (index != -1) {
+		return index;
+	}
+	
+	if (functionCoverageCapacity < functionCoverageCount + 1) {
+		functionCoverageCapacity = functionCoverageCapacity < 64 ? 64 : functionCoverageCapacity * 2;
+		functionCoverages = (FunctionCoverage*)realloc(
+				functionCoverages, sizeof(FunctionCoverage) * (size_t)functionCoverageCapacity);
+		
+		if (functionCoverages == NULL) {
+			exit(1);
+		}
+	}
+	
+	Chunk *chunk = &function->chunk;
+	FunctionCoverage *coverage = &functionCoverages[functionCoverageCount];
+	coverage->function = function;
+	coverage->name = copyFunctionName((Obj*)function);
+	coverage->line = function->line;
+	coverage->count = chunk->count;
+	coverage->lines = (int*)malloc(sizeof(int) * (size_t)(chunk->count + 1));
+	coverage->hits = (uint64_t*)calloc((size_t)chunk->count + 1, sizeof(uint64_t));
+	
+	if (coverage->lines == NULL || coverage->hits == NULL) {
+		exit(1);
+	}
+	
+	for (int run = 0; run < chunk->lineCount; run++) {
+		int end = run + 1 < chunk->lineCount ? chunk->lines[run + 1].offset : chunk->count;
+		
+		for (int offset = chunk->lines[run].offset; offset < end; offset++) {
+			coverage->lines[offset] = chunk->lines[run].line;
+		}
+	}
+	
+	indexTableAdd(&coverageIndices, function, 0, functionCoverageCount);
+	int coverageIndex = functionCoverageCount++;
+	
+	// Functions that are never called are covered with no executions.
+	for (int i = 0; i < chunk->constants.count; i++) {
+		Value constant = chunk->constants.values[i];
+		
+		if (IS_OBJ(constant) && IS_FUNCTION(constant)) {
+			getCoverageIndex(AS_FUNCTION(constant));
+		}
+	}
+	
+	return coverageIndex;
+}
+
+// Get a source file's lines, or `NULL` if it could not be read.
+static char **readSourceLines(const char *path, int *lineCount) {
+	FILE *file = path == NULL ? NULL : fopen(path, "rb");
+	
+	if (file == NULL) {
+		return NULL;
+	}
+	
+	char **lines = NULL;
+	int count = 0;
+	int capacity = 0;
+	char *buffer = NULL;
+	size_t length = 0;
+	size_t bufferCapacity = 0;
+	
+	for (int c = fgetc(file);; c = fgetc(file)) {
+		if (length + 1 >= bufferCapacity) {
+			bufferCapacity = bufferCapacity < 64 ? 64 : bufferCapacity * 2;
+			buffer = (char*)realloc(buffer, bufferCapacity);
+			
+			if (buffer == NULL) {
+				exit(1);
+			}
+		}
+		
+		if (c != '\n' && c != EOF) {
+			buffer[length++] = (char)c;
+			continue;
+		}
+		
+		if (capacity < count + 1) {
+			capacity = capacity < 64 ? 64 : capacity * 2;
+			lines = (char**)realloc(lines, sizeof(char*) * (size_t)capacity);
+			
+			if (lines == NULL) {
+				exit(1);
+			}
+		}
+		
+		buffer[length] = '\0';
+		lines[count++] = buffer;
+		buffer = NULL;
+		length = 0;
+		bufferCapacity = 0;
+		
+		if (c == EOF) {
+			break;
+		}
+	}
+	
+	fclose(file);
+	*lineCount = count;
+	return lines;
+}
+
+// Compare two lines' coverage by their executed instructions in descending
+// order.
+static int compareLineCoverages(const void *a, const void *b) {
+	uint64_t instructionsA = ((const LineCoverage*)a)->instructions;
+	uint64_t instructionsB = ((const LineCoverage*)b)->instructions;
+	return (instructionsA < instructionsB) - (instructionsA > instructionsB);
+}
+
+// Write the coverage to the coverage file as LCOV tracefile records, print the
+// hottest lines to the standard error stream, and free the coverage.
+static void writeCoverage() {
+	isRecordingCoverage = false;
+	flushOutput();
+	
+	int lineCount = 0;
+	
+	for (int i = 0; i < functionCoverageCount; i++) {
+		FunctionCoverage *coverage = &functionCoverages[i];
+		
+		for (int offset = 0; offset < coverage->count; offset++) {
+			if (coverage->lines[offset] >= lineCount) {
+				lineCount = coverage->lines[offset] + 1;
+			}
+		}
+	}
+	
+	LineCoverage *lines = (LineCoverage*)calloc((size_t)lineCount + 1, sizeof(LineCoverage));
+	
+	if (lines == NULL) {
+		exit(1);
+	}
+	
+	fprintf(coverageFile, "TN:\nSF:%s\n", coverageSourcePath == NULL ? "" : coverageSourcePath);
+	int functionsHit = 0;
+	
+	for (int i = 0; i < functionCoverageCount; i++) {
+		FunctionCoverage *coverage = &functionCoverages[i];
+		int line = coverage->line > 0 ? coverage->line : 1; // The script is declared before line 1.
+		fprintf(coverageFile, "FN:%d,%s:%d\n", line, coverage->name, line);
+		fprintf(
+				coverageFile, "FNDA:%llu,%s:%d\n",
+				(unsigned long long)coverage->hits[0], coverage->name, line);
+		
+		if (coverage->hits[0] > 0) {
+			functionsHit++;
+		}
+		
+		// Bytes after an instruction's opcode are never executed, so only
+		// offsets that were executed or start a line run are counted.
+		for (int offset = 0; offset < coverage->count; offset++) {
+			LineCoverage *line = &lines[coverage->lines[offset]];
+			uint64_t hits = coverage->hits[offset];
+			
+			if (offset == 0 || hits > 0 || coverage->lines[offset] != coverage->lines[offset - 1]) {
+				line->hasCode = true;
+			}
+			
+			if (hits > line->hits) {
+				line->hits = hits;
+			}
+			
+			line->instructions += hits;
+		}
+	}
+	
+	fprintf(coverageFile, "FNF:%d\nFNH:%d\n", functionCoverageCount, functionsHit);
+	int linesFound = 0;
+	int linesHit = 0;
+	
+	for (int i = 1; i < lineCount; i++) {
+		lines[i].line = i;
+		
+		if (lines[i].hasCode) {
+			fprintf(coverageFile, "DA:%d,%llu\n", i, (unsigned long long)lines[i].hits);
+			linesFound++;
+			linesHit += lines[i].hits > 0;
+		}
+	}
+	
+	fprintf(coverageFile, "LF:%d\nLH:%d\nend_of_record\n", linesFound, linesHit);
+	
+	if (fclose(coverageFile) == EOF) {
+		fprintf(stderr, "Could not write coverage.\n");
+	}
+	
+	int sourceLineCount = 0;
+	char **sourceLines = readSourceLines(coverageSourcePath, &sourceLineCount);
+	qsort(lines, (size_t)lineCount, sizeof(LineCoverage), compareLineCoverages);
+	
+	fprintf(stderr, "== hot lines ==\n");
+	fprintf(stderr, "%14s %12s %8s  %s\n", "instructions", "hits", "line", "source");
+	
+	for (int i = 0; i < lineCount && i < HOT_LINE_MAX && lines[i].instructions > 0; i++) {
+		LineCoverage *line = &lines[i];
+		const char *source = "";
+		
+		if (sourceLines != NULL && line->line <= sourceLineCount) {
+			source = sourceLines[line->line - 1];
+			source += strspn(source, " \t");
+		}
+		
+		fprintf(
+				stderr, "%14llu %12llu %8d  %s\n",
+				(unsigned long long)line->instructions, (unsigned long long)line->hits, line->line, source);
+	}
+	
+	for (int i = 0; i < sourceLineCount; i++) {
+		free(sourceLines[i]);
+	}
+	
+	for (int i = 0; i < functionCoverageCount; i++) {
+		free(functionCoverages[i].name);
+		free(functionCoverages[i].lines);
+		free(functionCoverages[i].hits);
+	}
+	
+	free(sourceLines);
+	free(lines);
+	free(functionCoverages);
+	freeIndexTable(&coverageIndices);
+	coverageFile = NULL;
+	functionCoverages = NULL;
+	functionCoverageCount = 0;
+	functionCoverageCapacity = 0;
+	lastCoverageIndex = -1;
+}
+
+bool initCoverage(const char *path, const char *sourcePath) {
+	coverageFile = fopen(path, "wb");
+	
+	if (coverageFile == NULL) {
+		return false; // Could not open coverage file.
+	}
+	
+	coverageSourcePath = sourcePath;
+	isRecordingCoverage = true;
+	isRecordingInstructions = true;
+	atexit(writeCoverage);
+	return true;
+}
+
+void recordCoverage(ObjFunction *function, int offset) {
+	if (lastCoverageIndex == -1 || functionCoverages[lastCoverageIndex].function != function) {
+		lastCoverageIndex = getCoverageIndex(function);
+	}
+	
+	functionCoverages[lastCoverageIndex].hits[offset]++;
+}
+
+void markCoverageRoots() {
+	for (int i = 0; i < functionCoverageCount; i++) {
+		markObject((Obj*)functionCoverages[i].function);
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef clox_coverage_h
+#define clox_coverage_h
+
+#include "common.h"
+#include "object.h"
+
+// Whether coverage is being recorded.
+extern bool isRecordingCoverage;
+
+// Start recording how many times each line of a source file is executed to
+// write as an LCOV tracefile to a path at exit, with the hottest lines printed,
+// and return whether recording was started.
+bool initCoverage(const char *path, const char *sourcePath);
+
+// Record an executed instruction from its function and offset.
+void recordCoverage(ObjFunction *function, int offset);
+
+// Mark the covered functions as reachable so that their objects are never
+// reused.
+void markCoverageRoots();
+
+#endif // !clox_coverage_h
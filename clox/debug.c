@@ -1,9 +1,60 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "debug.h"
 #include "object.h"
+#include "timing.h"
 #include "value.h"
 
+#ifdef DEBUG_OPCODE_STATS
+
+// The number of executed opcodes between timed opcodes.
+#define OPCODE_SAMPLE_INTERVAL 64
+
+// The number of most frequent opcode pairs to print.
+#define OPCODE_PAIR_MAX 32
+
+// The number of calls used to estimate the overhead of reading the clock.
+#define CLOCK_CALIBRATION_CALLS 1000
+
+// A pair of consecutively executed opcodes.
+typedef struct {
+	// The pair's first opcode.
+	uint8_t first;
+	
+	// The pair's second opcode.
+	uint8_t second;
+	
+	// The pair's number of executions.
+	uint64_t count;
+} OpcodePair;
+
+// The number of executions of each opcode.
+static uint64_t opcodeCounts[UINT8_COUNT];
+
+// The number of executions of each opcode after each opcode.
+static uint64_t pairCounts[UINT8_COUNT][UINT8_COUNT];
+
+// The number of timed executions of each opcode.
+static uint64_t timedCounts[UINT8_COUNT];
+
+// The total nanoseconds of timed executions of each opcode.
+static uint64_t timedNanoseconds[UINT8_COUNT];
+
+// The previous executed opcode, or `-1` if no opcode has been executed.
+static int previousOpcode = -1;
+
+// The timed opcode, or `-1` if no opcode is being timed.
+static int timedOpcode = -1;
+
+// The time in nanoseconds when the timed opcode started.
+static uint64_t timedStart = 0;
+
+// The number of opcodes to execute before the next timed opcode.
+static int sampleCountdown = OPCODE_SAMPLE_INTERVAL;
+
+#endif // DEBUG_OPCODE_STATS
+
 // An offset in a chunk.
 typedef struct {
 	// The cursor's chunk.
@@ -26,7 +77,7 @@ static Value cursorGetConstant(Cursor *cursor, ConstantIndex constant) {
 
 // Get a cursor's current line.
 static int cursorGetLine(Cursor *cursor) {
-	return cursor->chunk->lines[cursor->offset];
+	return getLine(cursor->chunk, cursor->offset);
 }
 
 // Fetch an 8-bit unsigned integer from a cursor.
@@ -61,6 +112,12 @@ static void byteInstruction(const char *name, Cursor *cursor) {
 	printf("%-16s %4d\n", name, operand);
 }
 
+// Disassemble an instruction with a 16-bit operand.
+static void shortInstruction(const char *name, Cursor *cursor) {
+	uint16_t operand = cursorFetchU16(cursor);
+	printf("%-16s %4d\n", name, operand);
+}
+
 // Disassemble an instruction with a constant operand.
 static void constantInstruction(const char *name, Cursor *cursor) {
 	ConstantIndex operand = cursorFetchConstant(cursor);
@@ -94,12 +151,13 @@ static void closureInstruction(const char *name, Cursor *cursor) {
 	ObjFunction *function = AS_FUNCTION(cursorGetConstant(cursor, constant));
 	
 	for (int i = 0; i < function->upvalueCount; i++) {
-		uint8_t isLocal = cursorFetchU8(cursor);
-		uint8_t index = cursorFetchU8(cursor);
+		int offset = cursor->offset;
+		uint8_t flags = cursorFetchU8(cursor);
+		uint16_t index = (flags & UPVALUE_LONG) ? cursorFetchU16(cursor) : cursorFetchU8(cursor);
 		
 		printf(
 				"%04d      |                     %s %d\n",
-				cursor->offset - 2, isLocal ? "local" : "upvalue", index);
+				offset, (flags & UPVALUE_LOCAL) ? "local" : "upvalue", index);
 	}
 }
 
@@ -107,52 +165,60 @@ static void closureInstruction(const char *name, Cursor *cursor) {
 static void disassemble(Cursor *cursor) {
 	printf("%04d ", cursor->offset);
 	
-	if (cursor->offset > 0 && cursorGetLine(cursor) == cursor->chunk->lines[cursor->offset - 1]) {
+	if (cursor->offset > 0 && cursorGetLine(cursor) == getLine(cursor->chunk, cursor->offset - 1)) {
 		printf("   | ");
 	} else {
 		printf("%4d ", cursorGetLine(cursor));
 	}
 	
 	uint8_t instruction = cursorFetchU8(cursor);
+	const char *name = getOpcodeName(instruction);
 	
 	switch (instruction) {
-		case OP_CONSTANT: constantInstruction("OP_CONSTANT", cursor); break;
-		case OP_NIL: simpleInstruction("OP_NIL"); break;
-		case OP_TRUE: simpleInstruction("OP_TRUE"); break;
-		case OP_FALSE: simpleInstruction("OP_FALSE"); break;
-		case OP_POP: simpleInstruction("OP_POP"); break;
-		case OP_GET_LOCAL: byteInstruction("OP_GET_LOCAL", cursor); break;
-		case OP_SET_LOCAL: byteInstruction("OP_SET_LOCAL", cursor); break;
-		case OP_GET_GLOBAL: constantInstruction("OP_GET_GLOBAL", cursor); break;
-		case OP_DEFINE_GLOBAL: constantInstruction("OP_DEFINE_GLOBAL", cursor); break;
-		case OP_SET_GLOBAL: constantInstruction("OP_SET_GLOBAL", cursor); break;
-		case OP_GET_UPVALUE: byteInstruction("OP_GET_UPVALUE", cursor); break;
-		case OP_SET_UPVALUE: byteInstruction("OP_SET_UPVALUE", cursor); break;
-		case OP_GET_PROPERTY: constantInstruction("OP_GET_PROPERTY", cursor); break;
-		case OP_SET_PROPERTY: constantInstruction("OP_SET_PROPERTY", cursor); break;
-		case OP_GET_SUPER: constantInstruction("OP_GET_SUPER", cursor); break;
-		case OP_EQUAL: simpleInstruction("OP_EQUAL"); break;
-		case OP_GREATER: simpleInstruction("OP_GREATER"); break;
-		case OP_LESS: simpleInstruction("OP_LESS"); break;
-		case OP_ADD: simpleInstruction("OP_ADD"); break;
-		case OP_SUBTRACT: simpleInstruction("OP_SUBTRACT"); break;
-		case OP_MULTIPLY: simpleInstruction("OP_MULTIPLY"); break;
-		case OP_DIVIDE: simpleInstruction("OP_DIVIDE"); break;
-		case OP_NOT: simpleInstruction("OP_NOT"); break;
-		case OP_NEGATE: simpleInstruction("OP_NEGATE"); break;
-		case OP_PRINT: simpleInstruction("OP_PRINT"); break;
-		case OP_JUMP: jumpInstruction("OP_JUMP", 1, cursor); break;
-		case OP_JUMP_IF_FALSE: jumpInstruction("OP_JUMP_IF_FALSE", 1, cursor); break;
-		case OP_LOOP: jumpInstruction("OP_LOOP", -1, cursor); break;
-		case OP_CALL: byteInstruction("OP_CALL", cursor); break;
-		case OP_INVOKE: invokeInstruction("OP_INVOKE", cursor); break;
-		case OP_SUPER_INVOKE: invokeInstruction("OP_SUPER_INVOKE", cursor); break;
-		case OP_CLOSURE: closureInstruction("OP_CLOSURE", cursor); break;
-		case OP_CLOSE_UPVALUE: simpleInstruction("OP_CLOSE_UPVALUE"); break;
-		case OP_RETURN: simpleInstruction("OP_RETURN"); break;
-		case OP_CLASS: constantInstruction("OP_CLASS", cursor); break;
-		case OP_INHERIT: simpleInstruction("OP_INHERIT"); break;
-		case OP_METHOD: constantInstruction("OP_METHOD", cursor); break;
+		case OP_CONSTANT: constantInstruction(name, cursor); break;
+		case OP_NIL: simpleInstruction(name); break;
+		case OP_TRUE: simpleInstruction(name); break;
+		case OP_FALSE: simpleInstruction(name); break;
+		case OP_POP: simpleInstruction(name); break;
+		case OP_GET_LOCAL: byteInstruction(name, cursor); break;
+		case OP_GET_LOCAL_LONG: shortInstruction(name, cursor); break;
+		case OP_SET_LOCAL: byteInstruction(name, cursor); break;
+		case OP_SET_LOCAL_LONG: shortInstruction(name, cursor); break;
+		case OP_GET_GLOBAL: constantInstruction(name, cursor); break;
+		case OP_DEFINE_GLOBAL: constantInstruction(name, cursor); break;
+		case OP_SET_GLOBAL: constantInstruction(name, cursor); break;
+		case OP_GET_UPVALUE: byteInstruction(name, cursor); break;
+		case OP_GET_UPVALUE_LONG: shortInstruction(name, cursor); break;
+		case OP_SET_UPVALUE: byteInstruction(name, cursor); break;
+		case OP_SET_UPVALUE_LONG: shortInstruction(name, cursor); break;
+		case OP_GET_PROPERTY: constantInstruction(name, cursor); break;
+		case OP_SET_PROPERTY: constantInstruction(name, cursor); break;
+		case OP_GET_SUPER: constantInstruction(name, cursor); break;
+		case OP_EQUAL: simpleInstruction(name); break;
+		case OP_GREATER: simpleInstruction(name); break;
+		case OP_LESS: simpleInstruction(name); break;
+		case OP_ADD: simpleInstruction(name); break;
+		case OP_SUBTRACT: simpleInstruction(name); break;
+		case OP_MULTIPLY: simpleInstruction(name); break;
+		case OP_DIVIDE: simpleInstruction(name); break;
+		case OP_NOT: simpleInstruction(name); break;
+		case OP_NEGATE: simpleInstruction(name); break;
+		case OP_PRINT: simpleInstruction(name); break;
+		case OP_JUMP: jumpInstruction(name, 1, cursor); break;
+		case OP_JUMP_IF_FALSE: jumpInstruction(name, 1, cursor); break;
+		case OP_LOOP: jumpInstruction(name, -1, cursor); break;
+		case OP_CALL: byteInstruction(name, cursor); break;
+		case OP_CALL_NATIVE: byteInstruction(name, cursor); break;
+		case OP_TAIL_CALL: byteInstruction(name, cursor); break;
+		case OP_INVOKE: invokeInstruction(name, cursor); break;
+		case OP_TAIL_INVOKE: invokeInstruction(name, cursor); break;
+		case OP_SUPER_INVOKE: invokeInstruction(name, cursor); break;
+		case OP_CLOSURE: closureInstruction(name, cursor); break;
+		case OP_CLOSE_UPVALUE: simpleInstruction(name); break;
+		case OP_RETURN: simpleInstruction(name); break;
+		case OP_CLASS: constantInstruction(name, cursor); break;
+		case OP_INHERIT: simpleInstruction(name); break;
+		case OP_METHOD: constantInstruction(name, cursor); break;
 		default: printf("Unknown opcode '%d'.\n", instruction); break;
 	}
 }
@@ -173,3 +239,179 @@ void disassembleInstruction(Chunk *chunk, int offset) {
 	initCursor(&cursor, chunk, offset);
 	disassemble(&cursor);
 }
+
+const char *getOpcodeName(uint8_t opcode) {
+	switch (opcode) {
+		case OP_CONSTANT: return "OP_CONSTANT";
+		case OP_NIL: return "OP_NIL";
+		case OP_TRUE: return "OP_TRUE";
+		case OP_FALSE: return "OP_FALSE";
+		case OP_POP: return "OP_POP";
+		case OP_GET_LOCAL: return "OP_GET_LOCAL";
+		case OP_GET_LOCAL_LONG: return "OP_GET_LOCAL_LONG";
+		case OP_SET_LOCAL: return "OP_SET_LOCAL";
+		case OP_SET_LOCAL_LONG: return "OP_SET_LOCAL_LONG";
+		case OP_GET_GLOBAL: return "OP_GET_GLOBAL";
+		case OP_DEFINE_GLOBAL: return "OP_DEFINE_GLOBAL";
+		case OP_SET_GLOBAL: return "OP_SET_GLOBAL";
+		case OP_GET_UPVALUE: return "OP_GET_UPVALUE";
+		case OP_GET_UPVALUE_LONG: return "OP_GET_UPVALUE_LONG";
+		case OP_SET_UPVALUE: return "OP_SET_UPVALUE";
+		case OP_SET_UPVALUE_LONG: return "OP_SET_UPVALUE_LONG";
+		case OP_GET_PROPERTY: return "OP_GET_PROPERTY";
+		case OP_SET_PROPERTY: return "OP_SET_PROPERTY";
+		case OP_GET_SUPER: return "OP_GET_SUPER";
+		case OP_EQUAL: return "OP_EQUAL";
+		case OP_GREATER: return "OP_GREATER";
+		case OP_LESS: return "OP_LESS";
+		case OP_ADD: return "OP_ADD";
+		case OP_SUBTRACT: return "OP_SUBTRACT";
+		case OP_MULTIPLY: return "OP_MULTIPLY";
+		case OP_DIVIDE: return "OP_DIVIDE";
+		case OP_NOT: return "OP_NOT";
+		case OP_NEGATE: return "OP_NEGATE";
+		case OP_PRINT: return "OP_PRINT";
+		case OP_JUMP: return "OP_JUMP";
+		case OP_JUMP_IF_FALSE: return "OP_JUMP_IF_FALSE";
+		case OP_LOOP: return "OP_LOOP";
+		case OP_CALL: return "OP_CALL";
+		case OP_CALL_NATIVE: return "OP_CALL_NATIVE";
+		case OP_TAIL_CALL: return "OP_TAIL_CALL";
+		case OP_INVOKE: return "OP_INVOKE";
+		case OP_TAIL_INVOKE: return "OP_TAIL_INVOKE";
+		case OP_SUPER_INVOKE: return "OP_SUPER_INVOKE";
+		case OP_CLOSURE: return "OP_CLOSURE";
+		case OP_CLOSE_UPVALUE: return "OP_CLOSE_UPVALUE";
+		case OP_RETURN: return "OP_RETURN";
+		case OP_CLASS: return "OP_CLASS";
+		case OP_INHERIT: return "OP_INHERIT";
+		case OP_METHOD: return "OP_METHOD";
+		default: return NULL;
+	}
+}
+
+#ifdef DEBUG_OPCODE_STATS
+
+void recordOpcode(uint8_t opcode) {
+	if (timedOpcode != -1) {
+		timedNanoseconds[timedOpcode] += getNanoseconds() - timedStart;
+		timedCounts[timedOpcode]++;
+		timedOpcode = -1;
+	}
+	
+	opcodeCounts[opcode]++;
+	
+	if (previousOpcode != -1) {
+		pairCounts[previousOpcode][opcode]++;
+	}
+	
+	previousOpcode = opcode;
+	
+	if (--sampleCountdown == 0) {
+		sampleCountdown = OPCODE_SAMPLE_INTERVAL;
+		timedOpcode = opcode;
+		timedStart = getNanoseconds();
+	}
+}
+
+// Compare two opcodes by their number of executions in descending order.
+static int compareOpcodes(const void *a, const void *b) {
+	uint64_t countA = opcodeCounts[*(const uint8_t*)a];
+	uint64_t countB = opcodeCounts[*(const uint8_t*)b];
+	return (countA < countB) - (countA > countB);
+}
+
+// Compare two opcode pairs by their number of executions in descending order.
+static int comparePairs(const void *a, const void *b) {
+	uint64_t countA = ((const OpcodePair*)a)->count;
+	uint64_t countB = ((const OpcodePair*)b)->count;
+	return (countA < countB) - (countA > countB);
+}
+
+// Get an opcode's name for printing statistics.
+static const char *getStatsName(uint8_t opcode) {
+	const char *name = getOpcodeName(opcode);
+	return name == NULL ? "OP_UNKNOWN" : name;
+}
+
+void printOpcodeStats() {
+	uint64_t total = 0;
+	uint8_t opcodes[UINT8_COUNT];
+	int opcodeCount = 0;
+	
+	for (int i = 0; i < UINT8_COUNT; i++) {
+		if (opcodeCounts[i] > 0) {
+			total += opcodeCounts[i];
+			opcodes[opcodeCount++] = (uint8_t)i;
+		}
+	}
+	
+	if (total == 0) {
+		return; // No opcodes were executed.
+	}
+	
+	qsort(opcodes, (size_t)opcodeCount, sizeof(uint8_t), compareOpcodes);
+	fflush(stdout);
+	
+	// Estimate the clock overhead included in each timed opcode.
+	uint64_t start = getNanoseconds();
+	
+	for (int i = 0; i < CLOCK_CALIBRATION_CALLS; i++) {
+		getNanoseconds();
+	}
+	
+	double overhead = (double)(getNanoseconds() - start) / CLOCK_CALIBRATION_CALLS;
+	
+	fprintf(stderr, "== opcode stats ==\n");
+	fprintf(stderr, "%-20s %14s %7s %10s\n", "opcode", "count", "share", "sampled ns");
+	
+	for (int i = 0; i < opcodeCount; i++) {
+		uint8_t opcode = opcodes[i];
+		double share = 100.0 * (double)opcodeCounts[opcode] / (double)total;
+		fprintf(stderr, "%-20s %14llu %6.2f%%", getStatsName(opcode), (unsigned long long)opcodeCounts[opcode], share);
+		
+		if (timedCounts[opcode] > 0) {
+			double nanoseconds = (double)timedNanoseconds[opcode] / (double)timedCounts[opcode] - overhead;
+			fprintf(stderr, " %10.1f\n", nanoseconds < 0 ? 0 : nanoseconds);
+		} else {
+			fprintf(stderr, " %10s\n", "-");
+		}
+	}
+	
+	fprintf(stderr, "%-20s %14llu\n", "total", (unsigned long long)total);
+	fprintf(stderr, "Sampled 1 in %d opcodes with %.1f ns of clock overhead removed.\n", OPCODE_SAMPLE_INTERVAL, overhead);
+	
+	OpcodePair *pairs = (OpcodePair*)malloc(sizeof(OpcodePair) * UINT8_COUNT * UINT8_COUNT);
+	int pairCount = 0;
+	
+	if (pairs == NULL) {
+		return; // Could not allocate pairs.
+	}
+	
+	for (int first = 0; first < UINT8_COUNT; first++) {
+		for (int second = 0; second < UINT8_COUNT; second++) {
+			if (pairCounts[first][second] > 0) {
+				OpcodePair *pair = &pairs[pairCount++];
+				pair->first = (uint8_t)first;
+				pair->second = (uint8_t)second;
+				pair->count = pairCounts[first][second];
+			}
+		}
+	}
+	
+	qsort(pairs, (size_t)pairCount, sizeof(OpcodePair), comparePairs);
+	
+	fprintf(stderr, "== opcode pair stats ==\n");
+	
+	for (int i = 0; i < pairCount && i < OPCODE_PAIR_MAX; i++) {
+		OpcodePair *pair = &pairs[i];
+		double share = 100.0 * (double)pair->count / (double)total;
+		fprintf(
+				stderr, "%-20s %-20s %14llu %6.2f%%\n",
+				getStatsName(pair->first), getStatsName(pair->second), (unsigned long long)pair->count, share);
+	}
+	
+	free(pairs);
+}
+
+#endif // DEBUG_OPCODE_STATS
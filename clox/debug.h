@@ -9,4 +9,17 @@ void disassembleChunk(Chunk *chunk, const char *name);
 // Disassemble an instruction at an offset in a chunk.
 void disassembleInstruction(Chunk *chunk, int offset);
 
+// Get an opcode's name, or `NULL` if the opcode is unknown.
+const char *getOpcodeName(uint8_t opcode);
+
+#ifdef DEBUG_OPCODE_STATS
+
+// Record an opcode's execution for opcode statistics.
+void recordOpcode(uint8_t opcode);
+
+// Print opcode statistics to the standard error stream.
+void printOpcodeStats();
+
+#endif // DEBUG_OPCODE_STATS
+
 #endif // !clox_debug_h
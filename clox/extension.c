@@ -4,7 +4,11 @@
 #include <string.h>
 
 #include "extension.h"
+#include "image.h"
+#include "mapping.h"
 #include "memory.h"
+#include "number.h"
+#include "vm.h"
 
 // The index of the user's standard input stream.
 #define USER_STDIN 0
@@ -18,11 +22,20 @@
 // The minimum index of a user's file stream.
 #define USER_FILE_MIN 3
 
-// The maximum index of a user's file stream.
-#define USER_FILE_MAX 7
+// The number of low bits of a stream handle that hold the stream's index.
+#define USER_INDEX_BITS 16
 
-// The buffer size for the native ftoa extension function.
-#define FTOA_SIZE 64
+// The maximum number of user streams.
+#define USER_STREAM_MAX (1 << USER_INDEX_BITS)
+
+// The number of generations of a stream index before its handles repeat.
+#define USER_GENERATION_MAX (1 << 15)
+
+// The maximum buffer size for a user's stream.
+#define USER_BUFFER_MAX (1 << 24)
+
+// The initial buffer size for the native freadall extension function.
+#define FREADALL_SIZE 4096
 
 // The number of command line arguments available to the user.
 static int userArgc = 0;
@@ -30,66 +43,170 @@ static int userArgc = 0;
 // The command line arguments available to the user.
 static const char **userArgv = NULL;
 
+// An I/O stream available to the user.
+typedef struct {
+	// The stream's file, or `NULL` if the stream is closed.
+	FILE *file;
+	
+	// The stream's buffer, or `NULL` if the stream does not own a buffer.
+	char *buffer;
+	
+	// Whether the stream's buffering has been set.
+	bool isBufferSet;
+	
+	// The stream's generation, which changes whenever the stream is closed.
+	int generation;
+	
+	// The index of the next closed stream, or `-1` if there is none.
+	int nextClosed;
+} UserStream;
+
 // The I/O streams available to the user.
-static FILE *userStreams[] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+static UserStream *userStreams = NULL;
 
-// Open a file from a path and mode.
-static Value openFile(const char *path, const char *mode) {
-	int index = USER_FILE_MIN;
+// The number of I/O streams available to the user.
+static int userStreamCount = 0;
+
+// The current maximum number of I/O streams available to the user.
+static int userStreamCapacity = 0;
+
+// The index of the first closed stream that can be reused, or `-1`.
+static int userClosedStream = -1;
+
+// Add an open stream from a file and return its index, or return `-1` if
+// there are too many streams.
+static int addStream(FILE *file) {
+	int index = userClosedStream;
 	
-	while (userStreams[index] != NULL) {
-		index++;
+	if (index != -1) {
+		userClosedStream = userStreams[index].nextClosed;
+	} else {
+		if (userStreamCount == USER_STREAM_MAX) {
+			return -1; // No available streams.
+		}
 		
-		if (index > USER_FILE_MAX) {
-			return NIL_VAL; // No available streams.
+		if (userStreamCapacity < userStreamCount + 1) {
+			userStreamCapacity = userStreamCapacity < 8 ? 8 : userStreamCapacity * 2;
+			userStreams = (UserStream*)realloc(userStreams, sizeof(UserStream) * userStreamCapacity);
+			
+			if (userStreams == NULL) {
+				exit(1);
+			}
 		}
+		
+		index = userStreamCount++;
+		userStreams[index].generation = 0;
+	}
+	
+	UserStream *stream = &userStreams[index];
+	stream->file = file;
+	stream->buffer = NULL;
+	stream->isBufferSet = false;
+	stream->nextClosed = -1;
+	return index;
+}
+
+// Close a stream from its index and return whether it was successful.
+static bool closeStream(int index) {
+	UserStream *stream = &userStreams[index];
+	int result = fclose(stream->file);
+	free(stream->buffer);
+	stream->file = NULL;
+	stream->buffer = NULL;
+	stream->generation = (stream->generation + 1) % USER_GENERATION_MAX;
+	stream->nextClosed = userClosedStream;
+	userClosedStream = index;
+	return result != EOF;
+}
+
+// Get a stream handle from its index.
+static Value getHandle(int index) {
+	int generation = userStreams[index].generation;
+	return NUMBER_VAL((double)((generation << USER_INDEX_BITS) | index));
+}
+
+// Get a stream's index from a handle, or return `-1` if the handle is not an
+// open stream.
+static int getStreamIndex(Value handle) {
+	double number = AS_NUMBER(handle);
+	
+	if (number < 0 || number >= (double)USER_STREAM_MAX * USER_GENERATION_MAX) {
+		return -1; // Handle out of range.
+	}
+	
+	int value = (int)number;
+	int index = value & (USER_STREAM_MAX - 1);
+	
+	if (
+			index >= userStreamCount
+			|| userStreams[index].file == NULL
+			|| userStreams[index].generation != value >> USER_INDEX_BITS) {
+		return -1; // Stream not open or handle is stale.
+	}
+	
+	return index;
+}
+
+// Get a stream's file from a handle, or return `NULL` if the handle is not an
+// open stream.
+static FILE *getStreamFile(Value handle) {
+	int index = getStreamIndex(handle);
+	return index == -1 ? NULL : userStreams[index].file;
+}
+
+// Get a stream's file for reading from a handle, or return `NULL` if the
+// handle is not an open stream. Output is flushed before reading from the
+// standard input stream so that any prompts are visible.
+static FILE *getReadFile(Value handle) {
+	int index = getStreamIndex(handle);
+	
+	if (index == USER_STDIN) {
+		flushOutput();
+	}
+	
+	return index == -1 ? NULL : userStreams[index].file;
+}
+
+// Get a stream's file for writing from a handle, or return `NULL` if the
+// handle is not an open stream. The standard output stream is flushed before
+// writing to the standard error stream so that output stays in order.
+static FILE *getWriteFile(Value handle) {
+	int index = getStreamIndex(handle);
+	
+	if (index == USER_STDERR) {
+		fflush(stdout);
 	}
 	
+	return index == -1 ? NULL : userStreams[index].file;
+}
+
+// Open a file from a path and mode.
+static Value openFile(const char *path, const char *mode) {
 	FILE *file = fopen(path, mode);
 	
 	if (file == NULL) {
 		return NIL_VAL; // Could not open file.
 	}
 	
-	userStreams[index] = file;
-	return NUMBER_VAL((double)index);
-}
-
-// Define a native extension function as having 0 parameters.
-#define PARAMS_0() \
-	do { \
-		(void)args; \
-		\
-		if (argCount != 0) { \
-			return NIL_VAL; \
-		} \
-	} while (false)
-
-// Define a native extension function as having 1 parameter.
-#define PARAMS_1(p1) \
-	do { \
-		if (argCount != 1 || !(p1(args[0]))) { \
-			return NIL_VAL; \
-		} \
-	} while (false)
-
-// Define a native extension function as having 2 parameters.
-#define PARAMS_2(p1, p2) \
-	do { \
-		if (argCount != 2 || !(p1(args[0])) || !(p2(args[1]))) { \
-			return NIL_VAL; \
-		} \
-	} while (false)
+	int index = addStream(file);
+	
+	if (index == -1) {
+		fclose(file);
+		return NIL_VAL; // No available streams.
+	}
+	
+	return getHandle(index);
+}
 
 // The native argc extension function.
-static Value argcExtension(int argCount, Value *args) {
-	PARAMS_0();
+static Value argcExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
 	return NUMBER_VAL((double)userArgc);
 }
 
 // The native argv extension function.
-static Value argvExtension(int argCount, Value *args) {
-	PARAMS_1(IS_NUMBER);
+static Value argvExtension(Value *args) {
 	int index = (int)AS_NUMBER(args[0]);
 	
 	if (index < 0 || index >= userArgc) {
@@ -101,9 +218,64 @@ static Value argvExtension(int argCount, Value *args) {
 	return OBJ_VAL(copyString(chars, length));
 }
 
+// The native arrget extension function.
+static Value arrgetExtension(Value *args) {
+	ValueArray *elements = &AS_ARRAY(args[0])->elements;
+	double index = AS_NUMBER(args[1]);
+	
+	if (index < 0 || index >= elements->count) {
+		return NIL_VAL; // Index out of bounds.
+	}
+	
+	return elements->values[(int)index];
+}
+
+// The native arrlen extension function.
+static Value arrlenExtension(Value *args) {
+	int length = AS_ARRAY(args[0])->elements.count;
+	return NUMBER_VAL((double)length);
+}
+
+// The native arrnew extension function.
+static Value arrnewExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
+	return OBJ_VAL(newArray());
+}
+
+// The native arrpop extension function.
+static Value arrpopExtension(Value *args) {
+	ValueArray *elements = &AS_ARRAY(args[0])->elements;
+	
+	if (elements->count == 0) {
+		return NIL_VAL; // Array is empty.
+	}
+	
+	return elements->values[--elements->count];
+}
+
+// The native arrpush extension function.
+static Value arrpushExtension(Value *args) {
+	ValueArray *elements = &AS_ARRAY(args[0])->elements;
+	writeValueArray(elements, args[1]);
+	return NUMBER_VAL((double)elements->count);
+}
+
+// The native arrset extension function.
+static Value arrsetExtension(Value *args) {
+	ValueArray *elements = &AS_ARRAY(args[0])->elements;
+	double index = AS_NUMBER(args[1]);
+	
+	if (index < 0 || index >= elements->count) {
+		return BOOL_VAL(false); // Index out of bounds.
+	}
+	
+	elements->values[(int)index] = args[2];
+	return BOOL_VAL(true);
+}
+
 // The native chrat extension function.
-static Value chratExtension(int argCount, Value *args) {
-	PARAMS_2(IS_STRING, IS_NUMBER);
+static Value chratExtension(Value *args) {
 	ObjString *text = AS_STRING(args[0]);
 	int index = (int)AS_NUMBER(args[1]);
 	
@@ -115,9 +287,29 @@ static Value chratExtension(int argCount, Value *args) {
 	return NUMBER_VAL((double)byte);
 }
 
+// The native chrfind extension function.
+static Value chrfindExtension(Value *args) {
+	ObjString *text = AS_STRING(args[0]);
+	double byte = AS_NUMBER(args[1]);
+	double from = AS_NUMBER(args[2]);
+	
+	if (byte < 0 || byte > 255 || from < 0 || from > text->length) {
+		return NIL_VAL; // Byte or index out of range.
+	}
+	
+	int start = (int)from;
+	const char *found = memchr(&text->chars[start], (int)byte, (size_t)(text->length - start));
+	
+	if (found == NULL) {
+		return NIL_VAL; // Byte not found.
+	}
+	
+	return NUMBER_VAL((double)(found - text->chars));
+}
+
 // The native exit extension function.
-static Value exitExtension(int argCount, Value *args) {
-	if (argCount != 1 || !IS_NUMBER(args[0])) {
+static Value exitExtension(Value *args) {
+	if (!IS_NUMBER(args[0])) {
 		exit(70);
 	}
 	
@@ -127,40 +319,30 @@ static Value exitExtension(int argCount, Value *args) {
 }
 
 // The native fclose extension function.
-static Value fcloseExtension(int argCount, Value *args) {
-	PARAMS_1(IS_NUMBER);
-	int index = (int)AS_NUMBER(args[0]);
-	
-	if (index < USER_FILE_MIN || index > USER_FILE_MAX) {
-		return BOOL_VAL(false); // Not a file stream.
-	}
-	
-	FILE *file = userStreams[index];
+static Value fcloseExtension(Value *args) {
+	int index = getStreamIndex(args[0]);
 	
-	if (file == NULL) {
-		return BOOL_VAL(false); // File already closed.
+	if (index < USER_FILE_MIN) {
+		return BOOL_VAL(false); // Not an open file stream.
 	}
 	
-	int result = fclose(file);
-	userStreams[index] = NULL;
+	return BOOL_VAL(closeStream(index));
+}
+
+// The native fflush extension function.
+static Value fflushExtension(Value *args) {
+	FILE *stream = getStreamFile(args[0]);
 	
-	if (result == EOF) {
-		return BOOL_VAL(false); // Could not close file.
+	if (stream == NULL) {
+		return BOOL_VAL(false); // Stream not open.
 	}
 	
-	return BOOL_VAL(true);
+	return BOOL_VAL(fflush(stream) != EOF);
 }
 
 // The native fgetc extension function.
-static Value fgetcExtension(int argCount, Value *args) {
-	PARAMS_1(IS_NUMBER);
-	int index = (int)AS_NUMBER(args[0]);
-	
-	if (index < 0 || index > USER_FILE_MAX) {
-		return NIL_VAL; // Not a stream.
-	}
-	
-	FILE *stream = userStreams[index];
+static Value fgetcExtension(Value *args) {
+	FILE *stream = getReadFile(args[0]);
 	
 	if (stream == NULL) {
 		return NIL_VAL; // Stream not open.
@@ -176,30 +358,26 @@ static Value fgetcExtension(int argCount, Value *args) {
 }
 
 // The native fopenr extension function.
-static Value fopenrExtension(int argCount, Value *args) {
-	PARAMS_1(IS_STRING);
+static Value fopenrExtension(Value *args) {
 	const char *path = AS_CSTRING(args[0]);
 	return openFile(path, "rb");
 }
 
 // The native fopenw extension function.
-static Value fopenwExtension(int argCount, Value *args) {
-	PARAMS_1(IS_STRING);
+static Value fopenwExtension(Value *args) {
 	const char *path = AS_CSTRING(args[0]);
 	return openFile(path, "wb");
 }
 
 // The native fputc extension function.
-static Value fputcExtension(int argCount, Value *args) {
-	PARAMS_2(IS_NUMBER, IS_NUMBER);
+static Value fputcExtension(Value *args) {
 	int byte = (int)AS_NUMBER(args[0]);
-	int index = (int)AS_NUMBER(args[1]);
 	
-	if (byte < 0 || byte > 255 || index < 0 || index > USER_FILE_MAX) {
-		return NIL_VAL; // Parameters out of range.
+	if (byte < 0 || byte > 255) {
+		return NIL_VAL; // Byte out of range.
 	}
 	
-	FILE *stream = userStreams[index];
+	FILE *stream = getWriteFile(args[1]);
 	
 	if (stream == NULL) {
 		return NIL_VAL; // Stream not open.
@@ -214,74 +392,363 @@ static Value fputcExtension(int argCount, Value *args) {
 	return NUMBER_VAL((double)result);
 }
 
-// The native ftoa extension function.
-static Value ftoaExtension(int argCount, Value *args) {
-	PARAMS_1(IS_NUMBER);
-	double number = AS_NUMBER(args[0]);
-	char *chars = ALLOCATE(char, FTOA_SIZE);
-	int length = snprintf(chars, FTOA_SIZE, "%f", number);
+// The native fread extension function.
+static Value freadExtension(Value *args) {
+	FILE *stream = getReadFile(args[0]);
+	double maxBytes = trunc(AS_NUMBER(args[1]));
+	
+	if (maxBytes < 1 || maxBytes >= INT32_MAX) {
+		return NIL_VAL; // Byte count out of range.
+	}
+	
+	if (stream == NULL) {
+		return NIL_VAL; // Stream not open.
+	}
+	
+	int capacity = (int)maxBytes + 1;
+	char *chars = ALLOCATE(char, capacity);
+	int length = (int)fread(chars, sizeof(char), (size_t)maxBytes, stream);
+	
+	if (length == 0) {
+		FREE_ARRAY(char, chars, capacity);
+		return NIL_VAL; // Could not read from stream.
+	}
+	
+	chars = GROW_ARRAY(char, chars, capacity, length + 1);
+	chars[length] = '\0';
+	return OBJ_VAL(takeString(chars, length));
+}
+
+// The native freadall extension function.
+static Value freadallExtension(Value *args) {
+	const char *path = AS_CSTRING(args[0]);
+	int length;
+	char *chars = mapFile(path, &length);
+	
+	if (chars != NULL) {
+		return OBJ_VAL(takeMappedString(chars, length));
+	}
 	
-	if (length >= FTOA_SIZE) {
-		length = FTOA_SIZE - 1;
+	FILE *file = fopen(path, "rb");
+	
+	if (file == NULL) {
+		return NIL_VAL; // Could not open file.
 	}
 	
-	char *point = strchr(chars, '.');
+	int capacity = FREADALL_SIZE;
+	length = 0;
+	chars = ALLOCATE(char, capacity);
 	
-	if (point != NULL) {
-		char *tail = &chars[length - 1];
+	for (;;) {
+		length += (int)fread(&chars[length], sizeof(char), (size_t)(capacity - length - 1), file);
 		
-		// Strip trailing zeroes.
-		while (tail > point && *tail == '0') {
-			*tail-- = '\0';
-			length--;
+		if (length < capacity - 1 || capacity > INT32_MAX / 2) {
+			break;
 		}
 		
-		// Strip trailing decimal point.
-		if (tail == point) {
-			*point = '\0';
-			length--;
+		chars = GROW_ARRAY(char, chars, capacity, capacity * 2);
+		capacity *= 2;
+	}
+	
+	bool isOk = !ferror(file) && feof(file);
+	
+	if (fclose(file) == EOF || !isOk) {
+		FREE_ARRAY(char, chars, capacity);
+		return NIL_VAL; // Could not read file.
+	}
+	
+	chars = GROW_ARRAY(char, chars, capacity, length + 1);
+	chars[length] = '\0';
+	return OBJ_VAL(takeString(chars, length));
+}
+
+// The native fsetvbuf extension function.
+static Value fsetvbufExtension(Value *args) {
+	int index = getStreamIndex(args[0]);
+	double size = trunc(AS_NUMBER(args[1]));
+	
+	if (index == -1 || userStreams[index].isBufferSet || size < 0 || size > USER_BUFFER_MAX) {
+		return BOOL_VAL(false); // Parameters out of range or buffer already set.
+	}
+	
+	UserStream *stream = &userStreams[index];
+	char *buffer = NULL;
+	
+	if (size > 0) {
+		buffer = (char*)malloc((size_t)size);
+		
+		if (buffer == NULL) {
+			return BOOL_VAL(false); // Could not allocate buffer.
 		}
 	}
 	
+	if (setvbuf(stream->file, buffer, buffer == NULL ? _IONBF : _IOFBF, (size_t)size) != 0) {
+		free(buffer);
+		return BOOL_VAL(false); // Could not set buffer.
+	}
+	
+	stream->buffer = buffer;
+	stream->isBufferSet = true;
+	return BOOL_VAL(true);
+}
+
+// The native ftoa extension function.
+static Value ftoaExtension(Value *args) {
+	double number = AS_NUMBER(args[0]);
+	
 	// Don't return negative zero.
-	if (length == 2 && chars[0] == '-' && chars[1] == '0') {
-		chars[0] = '0';
-		chars[1] = '\0';
-		length = 1;
+	if (number == 0) {
+		number = 0;
 	}
 	
-	chars = GROW_ARRAY(char, chars, FTOA_SIZE, length + 1);
-	return OBJ_VAL(takeString(chars, length));
+	char chars[NUMBER_BUFFER_SIZE];
+	int length = formatNumber(number, chars, false);
+	return OBJ_VAL(copyString(chars, length));
+}
+
+// The native fwrite extension function.
+static Value fwriteExtension(Value *args) {
+	ObjString *text = AS_STRING(args[0]);
+	FILE *stream = getWriteFile(args[1]);
+	
+	if (stream == NULL) {
+		return NIL_VAL; // Stream not open.
+	}
+	
+	size_t length = fwrite(text->chars, sizeof(char), (size_t)text->length, stream);
+	
+	if (length < (size_t)text->length) {
+		return NIL_VAL; // Could not write to stream.
+	}
+	
+	return NUMBER_VAL((double)length);
+}
+
+// The native mapdel extension function.
+static Value mapdelExtension(Value *args) {
+	return BOOL_VAL(mapDelete(AS_MAP(args[0]), args[1]));
+}
+
+// The native mapget extension function.
+static Value mapgetExtension(Value *args) {
+	Value value;
+	
+	if (!mapGet(AS_MAP(args[0]), args[1], &value)) {
+		return args[2]; // Key does not exist.
+	}
+	
+	return value;
+}
+
+// The native maphas extension function.
+static Value maphasExtension(Value *args) {
+	Value value;
+	return BOOL_VAL(mapGet(AS_MAP(args[0]), args[1], &value));
+}
+
+// The native mapkeys extension function.
+static Value mapkeysExtension(Value *args) {
+	ObjMap *map = AS_MAP(args[0]);
+	ObjArray *keys = newArray();
+	push(OBJ_VAL(keys));
+	
+	for (int i = 0; i < map->keys.count; i++) {
+		if (!IS_NIL(map->keys.values[i])) {
+			writeValueArray(&keys->elements, map->keys.values[i]);
+		}
+	}
+	
+	pop();
+	return OBJ_VAL(keys);
+}
+
+// The native mapnew extension function.
+static Value mapnewExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
+	return OBJ_VAL(newMap());
+}
+
+// The native mapset extension function.
+static Value mapsetExtension(Value *args) {
+	return BOOL_VAL(mapSet(AS_MAP(args[0]), args[1], args[2]));
+}
+
+// The native sbadd extension function.
+static Value sbaddExtension(Value *args) {
+	ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+	ObjString *text = AS_STRING(args[1]);
+	
+	if (!appendStringBuilder(builder, text->chars, text->length)) {
+		return NIL_VAL; // String builder too long.
+	}
+	
+	return NUMBER_VAL((double)builder->length);
+}
+
+// The native sbaddc extension function.
+static Value sbaddcExtension(Value *args) {
+	ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+	double byte = AS_NUMBER(args[1]);
+	
+	if (byte < 0 || byte > 255) {
+		return NIL_VAL; // Byte out of range.
+	}
+	
+	char chars[1] = {(char)(unsigned char)byte};
+	
+	if (!appendStringBuilder(builder, chars, 1)) {
+		return NIL_VAL; // String builder too long.
+	}
+	
+	return NUMBER_VAL((double)builder->length);
+}
+
+// The native sbaddn extension function.
+static Value sbaddnExtension(Value *args) {
+	ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+	double number = AS_NUMBER(args[1]);
+	
+	// Format numbers like the native ftoa extension function.
+	if (number == 0) {
+		number = 0;
+	}
+	
+	char chars[NUMBER_BUFFER_SIZE];
+	int length = formatNumber(number, chars, false);
+	
+	if (!appendStringBuilder(builder, chars, length)) {
+		return NIL_VAL; // String builder too long.
+	}
+	
+	return NUMBER_VAL((double)builder->length);
+}
+
+// The native sbclear extension function.
+static Value sbclearExtension(Value *args) {
+	AS_STRING_BUILDER(args[0])->length = 0;
+	return NIL_VAL;
+}
+
+// The native sbflush extension function.
+static Value sbflushExtension(Value *args) {
+	ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+	FILE *stream = getWriteFile(args[1]);
+	
+	if (stream == NULL) {
+		return NIL_VAL; // Stream not open.
+	}
+	
+	size_t length = fwrite(builder->chars, sizeof(char), (size_t)builder->length, stream);
+	
+	if (length < (size_t)builder->length) {
+		return NIL_VAL; // Could not write to stream.
+	}
+	
+	builder->length = 0;
+	return NUMBER_VAL((double)length);
+}
+
+// The native sblen extension function.
+static Value sblenExtension(Value *args) {
+	int length = AS_STRING_BUILDER(args[0])->length;
+	return NUMBER_VAL((double)length);
+}
+
+// The native sbnew extension function.
+static Value sbnewExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
+	return OBJ_VAL(newStringBuilder());
+}
+
+// The native sbstr extension function.
+static Value sbstrExtension(Value *args) {
+	ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+	return OBJ_VAL(copyString(builder->chars != NULL ? builder->chars : "", builder->length));
+}
+
+// The native snapshot extension function.
+static Value snapshotExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
+	if (!isSavingImage()) {
+		return BOOL_VAL(false); // Not saving an image.
+	}
+	
+	// Save the stack below the snapshot extension function.
+	if (!saveImage(args - 1)) {
+		fprintf(stderr, "Could not save image.\n");
+		exit(74);
+	}
+	
+	exit(0);
+	return NIL_VAL; // Unreachable.
 }
 
 // The native stderr extension function.
-static Value stderrExtension(int argCount, Value *args) {
-	PARAMS_0();
+static Value stderrExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
 	return NUMBER_VAL((double)USER_STDERR);
 }
 
 // The native stdin extension function.
-static Value stdinExtension(int argCount, Value *args) {
-	PARAMS_0();
+static Value stdinExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
 	return NUMBER_VAL((double)USER_STDIN);
 }
 
 // The native stdout extension function.
-static Value stdoutExtension(int argCount, Value *args) {
-	PARAMS_0();
+static Value stdoutExtension(Value *args) {
+	(void)args; // Unused parameter.
+	
 	return NUMBER_VAL((double)USER_STDOUT);
 }
 
+// The native strfind extension function.
+static Value strfindExtension(Value *args) {
+	ObjString *text = AS_STRING(args[0]);
+	ObjString *needle = AS_STRING(args[1]);
+	double from = AS_NUMBER(args[2]);
+	
+	if (from < 0 || from > text->length - needle->length) {
+		return NIL_VAL; // Index out of bounds or needle too long.
+	}
+	
+	int start = (int)from;
+	
+	if (needle->length == 0) {
+		return NUMBER_VAL((double)start);
+	}
+	
+	// Find candidates by their first byte before comparing them.
+	const char *end = &text->chars[text->length - needle->length + 1];
+	
+	for (const char *current = &text->chars[start]; current < end; current++) {
+		current = memchr(current, needle->chars[0], (size_t)(end - current));
+		
+		if (current == NULL) {
+			break;
+		}
+		
+		if (memcmp(current, needle->chars, (size_t)needle->length) == 0) {
+			return NUMBER_VAL((double)(current - text->chars));
+		}
+	}
+	
+	return NIL_VAL; // Needle not found.
+}
+
 // The native strlen extension function.
-static Value strlenExtension(int argCount, Value *args) {
-	PARAMS_1(IS_STRING);
+static Value strlenExtension(Value *args) {
 	int length = AS_STRING(args[0])->length;
 	return NUMBER_VAL((double)length);
 }
 
 // The native strof extension function.
-static Value strofExtension(int argCount, Value *args) {
-	PARAMS_1(IS_NUMBER);
+static Value strofExtension(Value *args) {
 	int byte = (int)AS_NUMBER(args[0]);
 	
 	if (byte < 1 || byte > 255) {
@@ -294,54 +761,94 @@ static Value strofExtension(int argCount, Value *args) {
 	return OBJ_VAL(takeString(chars, 1));
 }
 
+// The native substr extension function.
+static Value substrExtension(Value *args) {
+	ObjString *text = AS_STRING(args[0]);
+	double start = AS_NUMBER(args[1]);
+	double length = AS_NUMBER(args[2]);
+	
+	if (start < 0 || length < 0 || start + length > text->length) {
+		return NIL_VAL; // Range out of bounds.
+	}
+	
+	return OBJ_VAL(copyString(&text->chars[(int)start], (int)length));
+}
+
 // The native trunc extension function.
-static Value truncExtension(int argCount, Value *args) {
-	PARAMS_1(IS_NUMBER);
+static Value truncExtension(Value *args) {
 	double number = trunc(AS_NUMBER(args[0]));
 	return NUMBER_VAL(number);
 }
 
-#undef PARAMS_0
-#undef PARAMS_1
-#undef PARAMS_2
-
 void initExtensions(int argc, const char *argv[]) {
-	if (argc > 1) {
-		userArgc = argc - 1;
-		userArgv = &argv[1];
-	}
+	userArgc = argc;
+	userArgv = argv;
 	
-	userStreams[USER_STDIN] = stdin;
-	userStreams[USER_STDOUT] = stdout;
-	userStreams[USER_STDERR] = stderr;
+	addStream(stdin);
+	addStream(stdout);
+	addStream(stderr);
 }
 
 void defineExtensions(DefineNativeFn defineNative) {
-	defineNative("__argc", argcExtension);
-	defineNative("__argv", argvExtension);
-	defineNative("__chrat", chratExtension);
-	defineNative("__exit", exitExtension);
-	defineNative("__fclose", fcloseExtension);
-	defineNative("__fgetc", fgetcExtension);
-	defineNative("__fopenr", fopenrExtension);
-	defineNative("__fopenw", fopenwExtension);
-	defineNative("__fputc", fputcExtension);
-	defineNative("__ftoa", ftoaExtension);
-	defineNative("__stderr", stderrExtension);
-	defineNative("__stdin", stdinExtension);
-	defineNative("__stdout", stdoutExtension);
-	defineNative("__strlen", strlenExtension);
-	defineNative("__strof", strofExtension);
-	defineNative("__trunc", truncExtension);
+	defineNative("__argc", argcExtension, "");
+	defineNative("__argv", argvExtension, "n");
+	defineNative("__arrget", arrgetExtension, "an");
+	defineNative("__arrlen", arrlenExtension, "a");
+	defineNative("__arrnew", arrnewExtension, "");
+	defineNative("__arrpop", arrpopExtension, "a");
+	defineNative("__arrpush", arrpushExtension, "a*");
+	defineNative("__arrset", arrsetExtension, "an*");
+	defineNative("__chrat", chratExtension, "sn");
+	defineNative("__chrfind", chrfindExtension, "snn");
+	defineNative("__exit", exitExtension, "*");
+	defineNative("__fclose", fcloseExtension, "n");
+	defineNative("__fflush", fflushExtension, "n");
+	defineNative("__fgetc", fgetcExtension, "n");
+	defineNative("__fopenr", fopenrExtension, "s");
+	defineNative("__fopenw", fopenwExtension, "s");
+	defineNative("__fputc", fputcExtension, "nn");
+	defineNative("__fread", freadExtension, "nn");
+	defineNative("__freadall", freadallExtension, "s");
+	defineNative("__fsetvbuf", fsetvbufExtension, "nn");
+	defineNative("__ftoa", ftoaExtension, "n");
+	defineNative("__fwrite", fwriteExtension, "sn");
+	defineNative("__mapdel", mapdelExtension, "m*");
+	defineNative("__mapget", mapgetExtension, "m**");
+	defineNative("__maphas", maphasExtension, "m*");
+	defineNative("__mapkeys", mapkeysExtension, "m");
+	defineNative("__mapnew", mapnewExtension, "");
+	defineNative("__mapset", mapsetExtension, "m**");
+	defineNative("__sbadd", sbaddExtension, "bs");
+	defineNative("__sbaddc", sbaddcExtension, "bn");
+	defineNative("__sbaddn", sbaddnExtension, "bn");
+	defineNative("__sbclear", sbclearExtension, "b");
+	defineNative("__sbflush", sbflushExtension, "bn");
+	defineNative("__sblen", sblenExtension, "b");
+	defineNative("__sbnew", sbnewExtension, "");
+	defineNative("__sbstr", sbstrExtension, "b");
+	defineNative("__snapshot", snapshotExtension, "");
+	defineNative("__stderr", stderrExtension, "");
+	defineNative("__stdin", stdinExtension, "");
+	defineNative("__stdout", stdoutExtension, "");
+	defineNative("__strfind", strfindExtension, "ssn");
+	defineNative("__strlen", strlenExtension, "s");
+	defineNative("__strof", strofExtension, "n");
+	defineNative("__substr", substrExtension, "snn");
+	defineNative("__trunc", truncExtension, "n");
 }
 
 void freeExtensions() {
-	for (int i = USER_FILE_MIN; i <= USER_FILE_MAX; i++) {
-		FILE *file = userStreams[i];
-		
-		if (file != NULL) {
-			fclose(file);
-			userStreams[i] = NULL;
+	for (int i = USER_FILE_MIN; i < userStreamCount; i++) {
+		if (userStreams[i].file != NULL) {
+			closeStream(i);
 		}
 	}
+	
+	// Standard stream buffers are not freed because the streams are still
+	// flushed at exit.
+	free(userStreams);
+	userStreams = NULL;
+	userStreamCount = 0;
+	userStreamCapacity = 0;
+	userClosedStream = -1;
 }
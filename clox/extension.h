@@ -4,10 +4,11 @@
 #include "common.h"
 #include "object.h"
 
-// A function for defining a native function.
-typedef void (*DefineNativeFn)(const char *name, NativeFn function);
+// A function for defining a native function with a signature.
+typedef void (*DefineNativeFn)(const char *name, NativeFn function, const char *signature);
 
-// Initialize extension data from command line arguments.
+// Initialize extension data from the user's command line arguments, starting
+// at the script path.
 void initExtensions(int argc, const char *argv[]);
 
 // Define native extension functions using a native definition function.
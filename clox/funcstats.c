@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "funcstats.h"
+#include "indices.h"
+#include "memory.h"
+#include "timing.h"
+#include "vm.h"
+
+// A function's call statistics.
+typedef struct {
+	// The statistics' function or native object.
+	Obj *function;
+	
+	// The function's name, copied so that it can be printed after the function
+	// is freed.
+	char *name;
+	
+	// The line the function was declared on, or `-1` for natives.
+	int line;
+	
+	// The function's number of calls.
+	uint64_t calls;
+	
+	// The nanoseconds spent in the function, excluding its callees.
+	uint64_t selfNanoseconds;
+	
+	// The nanoseconds spent in the function's outermost calls, including their
+	// callees.
+	uint64_t totalNanoseconds;
+	
+	// The function's number of calls in progress.
+	int activeCount;
+} FunctionStats;
+
+// A call in progress for function statistics.
+typedef struct {
+	// The index of the called function's statistics.
+	int statsIndex;
+	
+	// The time in nanoseconds when the call started.
+	uint64_t start;
+	
+	// The nanoseconds spent in the call's callees.
+	uint64_t calleeNanoseconds;
+} ActiveCall;
+
+bool isRecordingCalls = false;
+
+// The call statistics of each called function.
+static FunctionStats *functionStats = NULL;
+
+// The number of called functions.
+static int functionStatsCount = 0;
+
+// The current maximum number of called functions.
+static int functionStatsCapacity = 0;
+
+// The indices into the call statistics by function.
+static IndexTable statsIndices;
+
+// The calls in progress.
+static ActiveCall *activeCalls = NULL;
+
+// The number of calls in progress.
+static int activeCallCount = 0;
+
+// The current maximum number of calls in progress.
+static int activeCallCapacity = 0;
+
+// Get the index of a function's call statistics, adding them if they do not
+// exist.
+static int getStatsIndex(Obj *function) {
+	int index = indexTableGet(&statsIndices, function, 0);
+	
+	if (index != -1) {
+		return index;
+	}
+	
+	if (functionStatsCapacity < functionStatsCount + 1) {
+		functionStatsCapacity = functionStatsCapacity < 64 ? 64 : functionStatsCapacity * 2;
+		functionStats = (FunctionStats*)realloc(functionStats, sizeof(FunctionStats) * (size_t)functionStatsCapacity);
+		
+		if (functionStats == NULL) {
+			exit(1);
+		}
+	}
+	
+	FunctionStats *stats = &functionStats[functionStatsCount];
+	stats->function = function;
+	stats->name = copyFunctionName(function);
+	stats->line = function->type == OBJ_NATIVE ? -1 : ((ObjFunction*)function)->line;
+	stats->calls = 0;
+	stats->selfNanoseconds = 0;
+	stats->totalNanoseconds = 0;
+	stats->activeCount = 0;
+	indexTableAdd(&statsIndices, function, 0, functionStatsCount);
+	return functionStatsCount++;
+}
+
+// Compare two functions' call statistics by their self time in descending
+// order.
+static int compareFunctionStats(const void *a, const void *b) {
+	uint64_t selfA = ((const FunctionStats*)a)->selfNanoseconds;
+	uint64_t selfB = ((const FunctionStats*)b)->selfNanoseconds;
+	return (selfA < selfB) - (selfA > selfB);
+}
+
+// Print the function call statistics to the standard error stream and free
+// them.
+static void printFunctionStats() {
+	leaveCalls();
+	isRecordingCalls = false;
+	flushOutput();
+	
+	qsort(functionStats, (size_t)functionStatsCount, sizeof(FunctionStats), compareFunctionStats);
+	
+	fprintf(stderr, "== function stats ==\n");
+	fprintf(stderr, "%-32s %8s %12s %12s %12s\n", "function", "line", "calls", "self ms", "total ms");
+	
+	for (int i = 0; i < functionStatsCount; i++) {
+		FunctionStats *stats = &functionStats[i];
+		char line[16] = "-";
+		
+		if (stats->line != -1) {
+			snprintf(line, sizeof(line), "%d", stats->line);
+		}
+		
+		fprintf(
+				stderr, "%-32s %8s %12llu %12.3f %12.3f\n",
+				stats->name, line, (unsigned long long)stats->calls,
+				(double)stats->selfNanoseconds / 1e6, (double)stats->totalNanoseconds / 1e6);
+		
+		free(stats->name);
+	}
+	
+	free(functionStats);
+	freeIndexTable(&statsIndices);
+	free(activeCalls);
+	functionStats = NULL;
+	functionStatsCount = 0;
+	functionStatsCapacity = 0;
+	activeCalls = NULL;
+	activeCallCount = 0;
+	activeCallCapacity = 0;
+}
+
+void initFunctionStats() {
+	isRecordingCalls = true;
+	atexit(printFunctionStats);
+}
+
+void enterCall(Obj *function) {
+	int statsIndex = getStatsIndex(function);
+	FunctionStats *stats = &functionStats[statsIndex];
+	stats->calls++;
+	stats->activeCount++;
+	
+	if (activeCallCapacity < activeCallCount + 1) {
+		activeCallCapacity = activeCallCapacity < 64 ? 64 : activeCallCapacity * 2;
+		activeCalls = (ActiveCall*)realloc(activeCalls, sizeof(ActiveCall) * (size_t)activeCallCapacity);
+		
+		if (activeCalls == NULL) {
+			exit(1);
+		}
+	}
+	
+	ActiveCall *call = &activeCalls[activeCallCount++];
+	call->statsIndex = statsIndex;
+	call->calleeNanoseconds = 0;
+	call->start = getNanoseconds();
+}
+
+void leaveCall() {
+	uint64_t end = getNanoseconds();
+	
+	if (activeCallCount == 0) {
+		return; // Calls resumed from an image were not entered.
+	}
+	
+	ActiveCall *call = &activeCalls[--activeCallCount];
+	uint64_t elapsed = end - call->start;
+	FunctionStats *stats = &functionStats[call->statsIndex];
+	stats->selfNanoseconds += elapsed - call->calleeNanoseconds;
+	
+	// Recursive calls are only included in the total of the outermost call.
+	if (--stats->activeCount == 0) {
+		stats->totalNanoseconds += elapsed;
+	}
+	
+	if (activeCallCount > 0) {
+		activeCalls[activeCallCount - 1].calleeNanoseconds += elapsed;
+	}
+}
+
+void leaveCalls() {
+	while (activeCallCount > 0) {
+		leaveCall();
+	}
+}
+
+void markFunctionStatsRoots() {
+	for (int i = 0; i < functionStatsCount; i++) {
+		markObject(functionStats[i].function);
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef clox_funcstats_h
+#define clox_funcstats_h
+
+#include "common.h"
+#include "object.h"
+
+// Whether function call statistics are being recorded.
+extern bool isRecordingCalls;
+
+// Start recording function call statistics to print at exit.
+void initFunctionStats();
+
+// Record entering a call to a function or native object.
+void enterCall(Obj *function);
+
+// Record leaving the most recently entered call.
+void leaveCall();
+
+// Record leaving all entered calls.
+void leaveCalls();
+
+// Mark the functions with call statistics as reachable so that their objects
+// are never reused.
+void markFunctionStatsRoots();
+
+#endif // !clox_funcstats_h
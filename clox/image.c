@@ -0,0 +1,989 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image.h"
+#include "memory.h"
+#include "object.h"
+#include "table.h"
+#include "vm.h"
+
+// The magic bytes at the start of an image.
+#define IMAGE_MAGIC "CLOXIMG"
+
+// The number of magic bytes at the start of an image.
+#define IMAGE_MAGIC_SIZE 8
+
+// The version of the image format.
+#define IMAGE_VERSION 8
+
+// An image object index representing a null object pointer.
+#define IMAGE_NULL UINT32_MAX
+
+#ifdef LONG_CONSTANTS
+
+// The image flags for the current build.
+#define IMAGE_FLAGS 1
+
+#else // LONG_CONSTANTS
+
+// The image flags for the current build.
+#define IMAGE_FLAGS 0
+
+#endif // !LONG_CONSTANTS
+
+// A value's tag in an image.
+typedef enum {
+	// A nil value's tag.
+	IMAGE_TAG_NIL,
+	
+	// A false value's tag.
+	IMAGE_TAG_FALSE,
+	
+	// A true value's tag.
+	IMAGE_TAG_TRUE,
+	
+	// A number value's tag.
+	IMAGE_TAG_NUMBER,
+	
+	// An object value's tag.
+	IMAGE_TAG_OBJ,
+} ImageTag;
+
+// A writer for saving an image.
+typedef struct {
+	// The writer's output file.
+	FILE *file;
+	
+	// Whether the writer encountered an error.
+	bool hadError;
+	
+	// The number of objects to write.
+	uint32_t count;
+	
+	// The current maximum number of objects to write.
+	uint32_t capacity;
+	
+	// The objects to write in index order.
+	Obj **objects;
+	
+	// The current maximum number of slots in the object index map.
+	uint32_t mapCapacity;
+	
+	// The object index map's object keys.
+	Obj **mapKeys;
+	
+	// The object index map's index values.
+	uint32_t *mapIndices;
+} ImageWriter;
+
+// A reader for loading an image.
+typedef struct {
+	// The reader's input file.
+	FILE *file;
+	
+	// Whether the reader encountered an error.
+	bool hadError;
+} ImageReader;
+
+// The optional path to save an image to.
+static const char *imageSavePath = NULL;
+
+// The objects loaded from an image in index order.
+static Obj **loadedObjects = NULL;
+
+// The number of objects loaded from an image.
+static uint32_t loadedCount = 0;
+
+// Allocate unmanaged memory or exit if there is not enough memory.
+static void *allocateUnmanaged(void *pointer, size_t size) {
+	void *result = realloc(pointer, size);
+	
+	if (result == NULL) {
+		exit(1);
+	}
+	
+	return result;
+}
+
+// Get an object's slot in an image writer's object index map.
+static uint32_t findMapSlot(Obj **keys, uint32_t capacity, Obj *object) {
+	uint32_t index = (uint32_t)(((uintptr_t)object >> 3) * 2654435761u) & (capacity - 1);
+	
+	while (keys[index] != NULL && keys[index] != object) {
+		index = (index + 1) & (capacity - 1);
+	}
+	
+	return index;
+}
+
+// Initialize an image writer from its output file.
+static void initWriter(ImageWriter *writer, FILE *file) {
+	writer->file = file;
+	writer->hadError = false;
+	writer->count = 0;
+	writer->capacity = 0;
+	writer->objects = NULL;
+	writer->mapCapacity = 0;
+	writer->mapKeys = NULL;
+	writer->mapIndices = NULL;
+}
+
+// Free an image writer.
+static void freeWriter(ImageWriter *writer) {
+	free(writer->objects);
+	free(writer->mapKeys);
+	free(writer->mapIndices);
+	initWriter(writer, NULL);
+}
+
+// Add an object to an image writer if it is new.
+static void addObject(ImageWriter *writer, Obj *object) {
+	if (object == NULL) {
+		return;
+	}
+	
+	if ((writer->count + 1) * 2 > writer->mapCapacity) {
+		uint32_t capacity = GROW_CAPACITY(writer->mapCapacity);
+		Obj **keys = allocateUnmanaged(NULL, sizeof(Obj*) * capacity);
+		uint32_t *indices = allocateUnmanaged(NULL, sizeof(uint32_t) * capacity);
+		
+		for (uint32_t i = 0; i < capacity; i++) {
+			keys[i] = NULL;
+		}
+		
+		for (uint32_t i = 0; i < writer->mapCapacity; i++) {
+			if (writer->mapKeys[i] != NULL) {
+				uint32_t slot = findMapSlot(keys, capacity, writer->mapKeys[i]);
+				keys[slot] = writer->mapKeys[i];
+				indices[slot] = writer->mapIndices[i];
+			}
+		}
+		
+		free(writer->mapKeys);
+		free(writer->mapIndices);
+		writer->mapKeys = keys;
+		writer->mapIndices = indices;
+		writer->mapCapacity = capacity;
+	}
+	
+	uint32_t slot = findMapSlot(writer->mapKeys, writer->mapCapacity, object);
+	
+	if (writer->mapKeys[slot] != NULL) {
+		return; // Object has already been added.
+	}
+	
+	if (writer->capacity < writer->count + 1) {
+		writer->capacity = GROW_CAPACITY(writer->capacity);
+		writer->objects = allocateUnmanaged(writer->objects, sizeof(Obj*) * writer->capacity);
+	}
+	
+	writer->mapKeys[slot] = object;
+	writer->mapIndices[slot] = writer->count;
+	writer->objects[writer->count++] = object;
+}
+
+// Add a value's object to an image writer if it is new.
+static void addValue(ImageWriter *writer, Value value) {
+	if (IS_OBJ(value)) {
+		addObject(writer, AS_OBJ(value));
+	}
+}
+
+// Add a hash table's objects to an image writer if they are new.
+static void addTable(ImageWriter *writer, Table *table) {
+	for (int i = 0; i < table->capacity; i++) {
+		Entry *entry = &table->entries[i];
+		
+		if (!IS_NIL(entry->key)) {
+			addValue(writer, entry->key);
+			addValue(writer, entry->value);
+		}
+	}
+}
+
+// Add an object's references to an image writer if they are new.
+static void addReferences(ImageWriter *writer, Obj *object) {
+	switch (object->type) {
+		case OBJ_ARRAY: {
+			ObjArray *array = (ObjArray*)object;
+			
+			for (int i = 0; i < array->elements.count; i++) {
+				addValue(writer, array->elements.values[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_BOUND_METHOD: {
+			ObjBoundMethod *bound = (ObjBoundMethod*)object;
+			addValue(writer, bound->receiver);
+			addObject(writer, (Obj*)bound->method);
+			break;
+		}
+		
+		case OBJ_CLASS: {
+			ObjClass *klass = (ObjClass*)object;
+			addObject(writer, (Obj*)klass->name);
+			addTable(writer, &klass->methods);
+			break;
+		}
+		
+		case OBJ_CLOSURE: {
+			ObjClosure *closure = (ObjClosure*)object;
+			addObject(writer, (Obj*)closure->function);
+			
+			for (int i = 0; i < closure->upvalueCount; i++) {
+				addObject(writer, (Obj*)closure->upvalues[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_FUNCTION: {
+			ObjFunction *function = (ObjFunction*)object;
+			addObject(writer, (Obj*)function->name);
+			
+			for (int i = 0; i < function->chunk.constants.count; i++) {
+				addValue(writer, function->chunk.constants.values[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_INSTANCE: {
+			ObjInstance *instance = (ObjInstance*)object;
+			addObject(writer, (Obj*)instance->klass);
+			addTable(writer, &instance->fields);
+			break;
+		}
+		
+		case OBJ_MAP: {
+			ObjMap *map = (ObjMap*)object;
+			
+			for (int i = 0; i < map->keys.count; i++) {
+				addValue(writer, map->keys.values[i]);
+				addValue(writer, map->values.values[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_UPVALUE:
+			addValue(writer, *((ObjUpvalue*)object)->location);
+			break;
+		case OBJ_NATIVE:
+		case OBJ_STRING:
+		case OBJ_STRING_BUILDER:
+			break; // Natives are written by name.
+	}
+}
+
+// Write bytes to an image writer.
+static void writeBytes(ImageWriter *writer, const void *bytes, size_t size) {
+	if (size > 0 && fwrite(bytes, 1, size, writer->file) != size) {
+		writer->hadError = true;
+	}
+}
+
+// Write an 8-bit unsigned integer to an image writer.
+static void writeU8(ImageWriter *writer, uint8_t value) {
+	writeBytes(writer, &value, sizeof(value));
+}
+
+// Write a 32-bit unsigned integer to an image writer.
+static void writeU32(ImageWriter *writer, uint32_t value) {
+	writeBytes(writer, &value, sizeof(value));
+}
+
+// Write an object reference to an image writer.
+static void writeRef(ImageWriter *writer, Obj *object) {
+	if (object == NULL) {
+		writeU32(writer, IMAGE_NULL);
+		return;
+	}
+	
+	uint32_t slot = findMapSlot(writer->mapKeys, writer->mapCapacity, object);
+	writeU32(writer, writer->mapIndices[slot]);
+}
+
+// Write a value to an image writer.
+static void writeValue(ImageWriter *writer, Value value) {
+	if (IS_NIL(value)) {
+		writeU8(writer, IMAGE_TAG_NIL);
+	} else if (IS_BOOL(value)) {
+		writeU8(writer, AS_BOOL(value) ? IMAGE_TAG_TRUE : IMAGE_TAG_FALSE);
+	} else if (IS_NUMBER(value)) {
+		double number = AS_NUMBER(value);
+		writeU8(writer, IMAGE_TAG_NUMBER);
+		writeBytes(writer, &number, sizeof(number));
+	} else {
+		writeU8(writer, IMAGE_TAG_OBJ);
+		writeRef(writer, AS_OBJ(value));
+	}
+}
+
+// Write a string's length and characters to an image writer.
+static void writeString(ImageWriter *writer, ObjString *string) {
+	writeU32(writer, (uint32_t)string->length);
+	writeBytes(writer, string->chars, (size_t)string->length);
+}
+
+// Write a hash table to an image writer.
+static void writeTable(ImageWriter *writer, Table *table) {
+	uint32_t count = 0;
+	
+	for (int i = 0; i < table->capacity; i++) {
+		if (!IS_NIL(table->entries[i].key)) {
+			count++;
+		}
+	}
+	
+	writeU32(writer, count);
+	
+	for (int i = 0; i < table->capacity; i++) {
+		Entry *entry = &table->entries[i];
+		
+		if (!IS_NIL(entry->key)) {
+			writeRef(writer, AS_OBJ(entry->key));
+			writeValue(writer, entry->value);
+		}
+	}
+}
+
+// Write the data needed to allocate an object to an image writer.
+static void writeObjectHeader(ImageWriter *writer, Obj *object) {
+	writeU8(writer, (uint8_t)object->type);
+	
+	switch (object->type) {
+		case OBJ_CLOSURE:
+			writeRef(writer, (Obj*)((ObjClosure*)object)->function);
+			break;
+		case OBJ_FUNCTION:
+			writeU32(writer, (uint32_t)((ObjFunction*)object)->arity);
+			writeU32(writer, (uint32_t)((ObjFunction*)object)->upvalueCount);
+			writeU32(writer, (uint32_t)((ObjFunction*)object)->slotCount);
+			writeU32(writer, (uint32_t)((ObjFunction*)object)->line);
+			break;
+		case OBJ_NATIVE:
+			writeString(writer, ((ObjNative*)object)->name);
+			break;
+		case OBJ_STRING:
+			writeString(writer, (ObjString*)object);
+			break;
+		case OBJ_STRING_BUILDER: {
+			ObjStringBuilder *builder = (ObjStringBuilder*)object;
+			writeU32(writer, (uint32_t)builder->length);
+			writeBytes(writer, builder->chars, (size_t)builder->length);
+			break;
+		}
+		case OBJ_ARRAY:
+		case OBJ_BOUND_METHOD:
+		case OBJ_CLASS:
+		case OBJ_INSTANCE:
+		case OBJ_MAP:
+		case OBJ_UPVALUE:
+			break; // No allocation data.
+	}
+}
+
+// Write an object's references to an image writer.
+static void writeObjectBody(ImageWriter *writer, Obj *object) {
+	switch (object->type) {
+		case OBJ_ARRAY: {
+			ObjArray *array = (ObjArray*)object;
+			writeU32(writer, (uint32_t)array->elements.count);
+			
+			for (int i = 0; i < array->elements.count; i++) {
+				writeValue(writer, array->elements.values[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_BOUND_METHOD: {
+			ObjBoundMethod *bound = (ObjBoundMethod*)object;
+			writeValue(writer, bound->receiver);
+			writeRef(writer, (Obj*)bound->method);
+			break;
+		}
+		
+		case OBJ_CLASS: {
+			ObjClass *klass = (ObjClass*)object;
+			writeRef(writer, (Obj*)klass->name);
+			writeTable(writer, &klass->methods);
+			break;
+		}
+		
+		case OBJ_CLOSURE: {
+			ObjClosure *closure = (ObjClosure*)object;
+			
+			for (int i = 0; i < closure->upvalueCount; i++) {
+				writeRef(writer, (Obj*)closure->upvalues[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_FUNCTION: {
+			ObjFunction *function = (ObjFunction*)object;
+			Chunk *chunk = &function->chunk;
+			writeRef(writer, (Obj*)function->name);
+			writeU32(writer, (uint32_t)chunk->count);
+			writeBytes(writer, chunk->code, (size_t)chunk->count);
+			writeU32(writer, (uint32_t)chunk->lineCount);
+			
+			for (int i = 0; i < chunk->lineCount; i++) {
+				writeU32(writer, (uint32_t)chunk->lines[i].offset);
+				writeU32(writer, (uint32_t)chunk->lines[i].line);
+			}
+			
+			writeU32(writer, (uint32_t)chunk->constants.count);
+			
+			for (int i = 0; i < chunk->constants.count; i++) {
+				writeValue(writer, chunk->constants.values[i]);
+			}
+			
+			break;
+		}
+		
+		case OBJ_INSTANCE: {
+			ObjInstance *instance = (ObjInstance*)object;
+			writeRef(writer, (Obj*)instance->klass);
+			writeTable(writer, &instance->fields);
+			break;
+		}
+		
+		case OBJ_MAP: {
+			ObjMap *map = (ObjMap*)object;
+			writeU32(writer, (uint32_t)map->count);
+			
+			for (int i = 0; i < map->keys.count; i++) {
+				if (!IS_NIL(map->keys.values[i])) {
+					writeValue(writer, map->keys.values[i]);
+					writeValue(writer, map->values.values[i]);
+				}
+			}
+			
+			break;
+		}
+		
+		case OBJ_UPVALUE: {
+			writeValue(writer, ((ObjUpvalue*)object)->closed);
+			break;
+		}
+		
+		case OBJ_NATIVE:
+		case OBJ_STRING:
+		case OBJ_STRING_BUILDER:
+			break; // No references.
+	}
+}
+
+void initImage(const char *savePath) {
+	imageSavePath = savePath;
+}
+
+bool isSavingImage() {
+	return imageSavePath != NULL;
+}
+
+bool saveImage(Value *stackTop) {
+	FILE *file = fopen(imageSavePath, "wb");
+	
+	if (file == NULL) {
+		return false;
+	}
+	
+	ImageWriter writer;
+	initWriter(&writer, file);
+	
+	addTable(&writer, &vm.globals);
+	
+	for (Value *slot = vm.stack; slot < stackTop; slot++) {
+		addValue(&writer, *slot);
+	}
+	
+	for (int i = 0; i < vm.frameCount; i++) {
+		addObject(&writer, (Obj*)vm.frames[i].closure);
+	}
+	
+	for (ObjUpvalue *upvalue = vm.openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		addObject(&writer, (Obj*)upvalue);
+	}
+	
+	// The object list grows while it is traversed.
+	for (uint32_t i = 0; i < writer.count; i++) {
+		addReferences(&writer, writer.objects[i]);
+	}
+	
+	char magic[IMAGE_MAGIC_SIZE] = IMAGE_MAGIC;
+	writeBytes(&writer, magic, IMAGE_MAGIC_SIZE);
+	writeU32(&writer, IMAGE_VERSION);
+	writeU32(&writer, IMAGE_FLAGS);
+	writeU32(&writer, writer.count);
+	
+	for (uint32_t i = 0; i < writer.count; i++) {
+		writeObjectHeader(&writer, writer.objects[i]);
+	}
+	
+	for (uint32_t i = 0; i < writer.count; i++) {
+		writeObjectBody(&writer, writer.objects[i]);
+	}
+	
+	writeTable(&writer, &vm.globals);
+	writeU32(&writer, (uint32_t)(stackTop - vm.stack));
+	
+	for (Value *slot = vm.stack; slot < stackTop; slot++) {
+		writeValue(&writer, *slot);
+	}
+	
+	writeU32(&writer, (uint32_t)vm.frameCount);
+	
+	for (int i = 0; i < vm.frameCount; i++) {
+		CallFrame *frame = &vm.frames[i];
+		writeRef(&writer, (Obj*)frame->closure);
+		writeU32(&writer, (uint32_t)(frame->ip - frame->closure->function->chunk.code));
+		writeU32(&writer, (uint32_t)(frame->slots - vm.stack));
+	}
+	
+	uint32_t openCount = 0;
+	
+	for (ObjUpvalue *upvalue = vm.openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		openCount++;
+	}
+	
+	writeU32(&writer, openCount);
+	
+	for (ObjUpvalue *upvalue = vm.openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		writeRef(&writer, (Obj*)upvalue);
+		writeU32(&writer, (uint32_t)(upvalue->location - vm.stack));
+	}
+	
+	bool isOk = !writer.hadError;
+	freeWriter(&writer);
+	
+	if (fclose(file) == EOF) {
+		isOk = false;
+	}
+	
+	return isOk;
+}
+
+// Read bytes from an image reader.
+static void readBytes(ImageReader *reader, void *bytes, size_t size) {
+	if (size > 0 && fread(bytes, 1, size, reader->file) != size) {
+		reader->hadError = true;
+		memset(bytes, 0, size);
+	}
+}
+
+// Read an 8-bit unsigned integer from an image reader.
+static uint8_t readU8(ImageReader *reader) {
+	uint8_t value;
+	readBytes(reader, &value, sizeof(value));
+	return value;
+}
+
+// Read a 32-bit unsigned integer from an image reader.
+static uint32_t readU32(ImageReader *reader) {
+	uint32_t value;
+	readBytes(reader, &value, sizeof(value));
+	return value;
+}
+
+// Read a 32-bit unsigned integer with a maximum value from an image reader.
+static uint32_t readCount(ImageReader *reader, uint32_t max) {
+	uint32_t value = readU32(reader);
+	
+	if (value > max) {
+		reader->hadError = true;
+		return 0;
+	}
+	
+	return value;
+}
+
+// Read an object reference from an image reader.
+static Obj *readRef(ImageReader *reader) {
+	uint32_t index = readU32(reader);
+	
+	if (index == IMAGE_NULL) {
+		return NULL;
+	}
+	
+	if (index >= loadedCount || loadedObjects[index] == NULL) {
+		reader->hadError = true;
+		return NULL;
+	}
+	
+	return loadedObjects[index];
+}
+
+// Read an object reference of an object type from an image reader.
+static Obj *readTypedRef(ImageReader *reader, ObjType type, bool isNullable) {
+	Obj *object = readRef(reader);
+	
+	if (object == NULL ? !isNullable : object->type != type) {
+		reader->hadError = true;
+		return NULL;
+	}
+	
+	return object;
+}
+
+// Read a value from an image reader.
+static Value readValue(ImageReader *reader) {
+	switch (readU8(reader)) {
+		case IMAGE_TAG_NIL: return NIL_VAL;
+		case IMAGE_TAG_FALSE: return BOOL_VAL(false);
+		case IMAGE_TAG_TRUE: return BOOL_VAL(true);
+		case IMAGE_TAG_NUMBER: {
+			double number;
+			readBytes(reader, &number, sizeof(number));
+			return NUMBER_VAL(number);
+		}
+		case IMAGE_TAG_OBJ: {
+			Obj *object = readRef(reader);
+			
+			if (object == NULL) {
+				reader->hadError = true;
+				return NIL_VAL;
+			}
+			
+			return OBJ_VAL(object);
+		}
+	}
+	
+	reader->hadError = true;
+	return NIL_VAL;
+}
+
+// Read a string object from an image reader.
+static ObjString *readString(ImageReader *reader) {
+	int length = (int)readCount(reader, INT32_MAX - 1);
+	char *chars = ALLOCATE(char, length + 1);
+	readBytes(reader, chars, (size_t)length);
+	chars[length] = '\0';
+	return takeString(chars, length);
+}
+
+// Read a hash table from an image reader.
+static void readTable(ImageReader *reader, Table *table) {
+	uint32_t count = readU32(reader);
+	
+	for (uint32_t i = 0; i < count && !reader->hadError; i++) {
+		ObjString *key = (ObjString*)readTypedRef(reader, OBJ_STRING, false);
+		Value value = readValue(reader);
+		
+		if (!reader->hadError) {
+			tableSet(table, key, value);
+		}
+	}
+}
+
+// Read the data needed to allocate an object from an image reader and return
+// the allocated object.
+static Obj *readObjectHeader(ImageReader *reader, uint32_t *functionIndex) {
+	switch (readU8(reader)) {
+		case OBJ_ARRAY: return (Obj*)newArray();
+		case OBJ_BOUND_METHOD: return (Obj*)newBoundMethod(NIL_VAL, NULL);
+		case OBJ_CLASS: return (Obj*)newClass(NULL);
+		case OBJ_CLOSURE: {
+			*functionIndex = readU32(reader);
+			return NULL; // Closures are allocated after their functions.
+		}
+		case OBJ_FUNCTION: {
+			ObjFunction *function = newFunction();
+			function->arity = (int)readCount(reader, UINT8_MAX);
+			function->upvalueCount = (int)readCount(reader, UINT16_COUNT);
+			function->slotCount = (int)readCount(reader, UINT16_COUNT);
+			function->line = (int)readCount(reader, INT32_MAX);
+			return (Obj*)function;
+		}
+		case OBJ_INSTANCE: return (Obj*)newInstance(NULL);
+		case OBJ_MAP: return (Obj*)newMap();
+		case OBJ_NATIVE: {
+			ObjString *name = readString(reader);
+			Value native;
+			
+			if (!tableGet(&vm.globals, name, &native) || !IS_NATIVE(native)) {
+				reader->hadError = true;
+				return NULL; // Native does not exist.
+			}
+			
+			return AS_OBJ(native);
+		}
+		case OBJ_STRING: return (Obj*)readString(reader);
+		case OBJ_STRING_BUILDER: {
+			int length = (int)readCount(reader, INT32_MAX - 1);
+			char *chars = ALLOCATE(char, length);
+			readBytes(reader, chars, (size_t)length);
+			
+			// Allocate the bytes first so a collection can't free the builder.
+			ObjStringBuilder *builder = newStringBuilder();
+			builder->length = length;
+			builder->capacity = length;
+			builder->chars = chars;
+			return (Obj*)builder;
+		}
+		case OBJ_UPVALUE: return (Obj*)newUpvalue(NULL);
+	}
+	
+	reader->hadError = true;
+	return NULL;
+}
+
+// Read an object's references from an image reader.
+static void readObjectBody(ImageReader *reader, Obj *object) {
+	switch (object->type) {
+		case OBJ_ARRAY: {
+			ObjArray *array = (ObjArray*)object;
+			uint32_t count = readCount(reader, INT32_MAX / sizeof(Value));
+			
+			for (uint32_t i = 0; i < count && !reader->hadError; i++) {
+				writeValueArray(&array->elements, readValue(reader));
+			}
+			
+			break;
+		}
+		
+		case OBJ_BOUND_METHOD: {
+			ObjBoundMethod *bound = (ObjBoundMethod*)object;
+			bound->receiver = readValue(reader);
+			bound->method = (ObjClosure*)readTypedRef(reader, OBJ_CLOSURE, false);
+			break;
+		}
+		
+		case OBJ_CLASS: {
+			ObjClass *klass = (ObjClass*)object;
+			klass->name = (ObjString*)readTypedRef(reader, OBJ_STRING, false);
+			readTable(reader, &klass->methods);
+			break;
+		}
+		
+		case OBJ_CLOSURE: {
+			ObjClosure *closure = (ObjClosure*)object;
+			
+			for (int i = 0; i < closure->upvalueCount; i++) {
+				closure->upvalues[i] = (ObjUpvalue*)readTypedRef(reader, OBJ_UPVALUE, false);
+			}
+			
+			break;
+		}
+		
+		case OBJ_FUNCTION: {
+			ObjFunction *function = (ObjFunction*)object;
+			function->name = (ObjString*)readTypedRef(reader, OBJ_STRING, true);
+			int count = (int)readCount(reader, INT32_MAX);
+			uint8_t *code = (uint8_t*)allocateUnmanaged(NULL, (size_t)count + 1);
+			readBytes(reader, code, (size_t)count);
+			int lineCount = (int)readCount(reader, (uint32_t)count);
+			LineStart *lines = allocateUnmanaged(NULL, sizeof(LineStart) * ((size_t)lineCount + 1));
+			
+			for (int i = 0; i < lineCount; i++) {
+				lines[i].offset = (int)readU32(reader);
+				lines[i].line = (int)readU32(reader);
+			}
+			
+			if (count > 0 && (lineCount == 0 || lines[0].offset != 0)) {
+				reader->hadError = true;
+			}
+			
+			// Rebuild the line runs by writing each line run's bytes.
+			for (int i = 0; i < lineCount && !reader->hadError; i++) {
+				int end = i + 1 < lineCount ? lines[i + 1].offset : count;
+				
+				if (end <= lines[i].offset || end > count) {
+					reader->hadError = true;
+					break;
+				}
+				
+				for (int offset = lines[i].offset; offset < end; offset++) {
+					writeChunk(&function->chunk, code[offset], lines[i].line);
+				}
+			}
+			
+			free(lines);
+			free(code);
+			count = (int)readCount(reader, CONSTANT_INDEX_MAX + 1);
+			
+			for (int i = 0; i < count && !reader->hadError; i++) {
+				writeValueArray(&function->chunk.constants, readValue(reader));
+			}
+			
+			break;
+		}
+		
+		case OBJ_INSTANCE: {
+			ObjInstance *instance = (ObjInstance*)object;
+			instance->klass = (ObjClass*)readTypedRef(reader, OBJ_CLASS, false);
+			readTable(reader, &instance->fields);
+			break;
+		}
+		
+		case OBJ_MAP: {
+			// Maps are rebuilt because object keys are hashed by address.
+			ObjMap *map = (ObjMap*)object;
+			uint32_t count = readCount(reader, INT32_MAX / sizeof(Value));
+			
+			for (uint32_t i = 0; i < count && !reader->hadError; i++) {
+				Value key = readValue(reader);
+				Value value = readValue(reader);
+				
+				if (!reader->hadError && !mapSet(map, key, value)) {
+					reader->hadError = true;
+				}
+			}
+			
+			break;
+		}
+		
+		case OBJ_UPVALUE: {
+			ObjUpvalue *upvalue = (ObjUpvalue*)object;
+			upvalue->closed = readValue(reader);
+			upvalue->location = &upvalue->closed; // Open upvalues are relocated later.
+			break;
+		}
+		
+		case OBJ_NATIVE:
+		case OBJ_STRING:
+		case OBJ_STRING_BUILDER:
+			break; // No references.
+	}
+}
+
+// Read the execution state from an image reader.
+static void readState(ImageReader *reader) {
+	readTable(reader, &vm.globals);
+	
+	uint32_t stackCount = readCount(reader, INT32_MAX / sizeof(Value) - STACK_HEADROOM);
+	vm.stackTop = vm.stack;
+	reserveStack((int)stackCount + STACK_HEADROOM);
+	
+	for (uint32_t i = 0; i < stackCount && !reader->hadError; i++) {
+		push(readValue(reader));
+	}
+	
+	uint32_t frameCount = readCount(reader, (uint32_t)vm.maxFrames);
+	
+	if (frameCount == 0) {
+		reader->hadError = true;
+	}
+	
+	reserveFrames((int)frameCount);
+	
+	for (uint32_t i = 0; i < frameCount && !reader->hadError; i++) {
+		ObjClosure *closure = (ObjClosure*)readTypedRef(reader, OBJ_CLOSURE, false);
+		uint32_t ip = readU32(reader);
+		uint32_t slots = readCount(reader, stackCount);
+		
+		if (reader->hadError || ip > (uint32_t)closure->function->chunk.count) {
+			reader->hadError = true;
+			break;
+		}
+		
+		reserveStack((int)slots + closure->function->slotCount + STACK_HEADROOM);
+		
+		CallFrame *frame = &vm.frames[vm.frameCount++];
+		frame->closure = closure;
+		frame->ip = closure->function->chunk.code + ip;
+		frame->slots = vm.stack + slots;
+	}
+	
+	uint32_t openCount = readU32(reader);
+	ObjUpvalue **link = &vm.openUpvalues;
+	
+	for (uint32_t i = 0; i < openCount && !reader->hadError; i++) {
+		ObjUpvalue *upvalue = (ObjUpvalue*)readTypedRef(reader, OBJ_UPVALUE, false);
+		uint32_t slot = readU32(reader);
+		
+		if (reader->hadError || slot >= stackCount) {
+			reader->hadError = true;
+			break;
+		}
+		
+		upvalue->location = vm.stack + slot; // Relocate to the new stack.
+		*link = upvalue;
+		link = &upvalue->next;
+	}
+}
+
+bool loadImage(const char *path) {
+	FILE *file = fopen(path, "rb");
+	
+	if (file == NULL) {
+		return false;
+	}
+	
+	ImageReader reader;
+	reader.file = file;
+	reader.hadError = false;
+	
+	char magic[IMAGE_MAGIC_SIZE];
+	readBytes(&reader, magic, IMAGE_MAGIC_SIZE);
+	
+	if (
+			memcmp(magic, IMAGE_MAGIC, IMAGE_MAGIC_SIZE) != 0
+			|| readU32(&reader) != IMAGE_VERSION
+			|| readU32(&reader) != IMAGE_FLAGS) {
+		fclose(file);
+		return false;
+	}
+	
+	uint32_t count = readCount(&reader, INT32_MAX / sizeof(Obj*));
+	loadedObjects = allocateUnmanaged(NULL, sizeof(Obj*) * ((size_t)count + 1));
+	uint32_t *functionIndices = allocateUnmanaged(NULL, sizeof(uint32_t) * ((size_t)count + 1));
+	
+	for (uint32_t i = 0; i < count && !reader.hadError; i++) {
+		functionIndices[i] = IMAGE_NULL;
+		loadedObjects[i] = readObjectHeader(&reader, &functionIndices[i]);
+		loadedCount++;
+	}
+	
+	for (uint32_t i = 0; i < loadedCount && !reader.hadError; i++) {
+		uint32_t index = functionIndices[i];
+		
+		if (index == IMAGE_NULL) {
+			continue;
+		}
+		
+		if (
+				index >= loadedCount
+				|| loadedObjects[index] == NULL
+				|| loadedObjects[index]->type != OBJ_FUNCTION) {
+			reader.hadError = true;
+			break;
+		}
+		
+		loadedObjects[i] = (Obj*)newClosure((ObjFunction*)loadedObjects[index]);
+	}
+	
+	free(functionIndices);
+	
+	for (uint32_t i = 0; i < loadedCount && !reader.hadError; i++) {
+		readObjectBody(&reader, loadedObjects[i]);
+	}
+	
+	if (!reader.hadError) {
+		readState(&reader);
+	}
+	
+	fclose(file);
+	free(loadedObjects);
+	loadedObjects = NULL;
+	loadedCount = 0;
+	
+	if (reader.hadError) {
+		return false;
+	}
+	
+	push(BOOL_VAL(true)); // Resume from the snapshot extension.
+	return true;
+}
+
+void markImageRoots() {
+	for (uint32_t i = 0; i < loadedCount; i++) {
+		markObject(loadedObjects[i]);
+	}
+}
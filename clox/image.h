@@ -0,0 +1,24 @@
+#ifndef clox_image_h
+#define clox_image_h
+
+#include "common.h"
+#include "value.h"
+
+// Initialize image saving from an optional path to save an image to.
+void initImage(const char *savePath);
+
+// Get whether an image will be saved when a snapshot is reached.
+bool isSavingImage();
+
+// Save the heap and execution state below a stack top to an image and return
+// whether it was successful.
+bool saveImage(Value *stackTop);
+
+// Load the heap and execution state from an image path and return whether it
+// was successful.
+bool loadImage(const char *path);
+
+// Mark all image root objects as reachable.
+void markImageRoots();
+
+#endif // !clox_image_h
@@ -0,0 +1,82 @@
+#include <stdlib.h>
+
+#include "indices.h"
+
+// The maximum load factor of an index table.
+#define INDEX_TABLE_MAX_LOAD 0.75
+
+// The minimum capacity of an index table that is not empty.
+#define INDEX_TABLE_MIN_CAPACITY 64
+
+void initIndexTable(IndexTable *table) {
+	table->count = 0;
+	table->capacity = 0;
+	table->entries = NULL;
+}
+
+void freeIndexTable(IndexTable *table) {
+	free(table->entries);
+	initIndexTable(table);
+}
+
+// Find an entry for a key in an array of index table entries.
+static IndexEntry *findIndexEntry(IndexEntry *entries, int capacity, const void *pointer, int number) {
+	uint32_t hash = (uint32_t)((uintptr_t)pointer >> 3) * 2654435769u ^ (uint32_t)number * 16777619u;
+	uint32_t index = hash & (uint32_t)(capacity - 1);
+	
+	for (;;) {
+		IndexEntry *entry = &entries[index];
+		
+		if (entry->index == -1 || (entry->pointer == pointer && entry->number == number)) {
+			return entry;
+		}
+		
+		index = (index + 1) & (uint32_t)(capacity - 1);
+	}
+}
+
+// Grow an index table's entries to a capacity.
+static void growIndexTable(IndexTable *table, int capacity) {
+	IndexEntry *entries = (IndexEntry*)malloc(sizeof(IndexEntry) * (size_t)capacity);
+	
+	if (entries == NULL) {
+		exit(1);
+	}
+	
+	for (int i = 0; i < capacity; i++) {
+		entries[i].index = -1;
+	}
+	
+	for (int i = 0; i < table->capacity; i++) {
+		IndexEntry *entry = &table->entries[i];
+		
+		if (entry->index != -1) {
+			*findIndexEntry(entries, capacity, entry->pointer, entry->number) = *entry;
+		}
+	}
+	
+	free(table->entries);
+	table->entries = entries;
+	table->capacity = capacity;
+}
+
+int indexTableGet(IndexTable *table, const void *pointer, int number) {
+	if (table->count == 0) {
+		return -1;
+	}
+	
+	return findIndexEntry(table->entries, table->capacity, pointer, number)->index;
+}
+
+void indexTableAdd(IndexTable *table, const void *pointer, int number, int index) {
+	if (table->count + 1 > table->capacity * INDEX_TABLE_MAX_LOAD) {
+		growIndexTable(
+				table, table->capacity < INDEX_TABLE_MIN_CAPACITY ? INDEX_TABLE_MIN_CAPACITY : table->capacity * 2);
+	}
+	
+	IndexEntry *entry = findIndexEntry(table->entries, table->capacity, pointer, number);
+	entry->pointer = pointer;
+	entry->number = number;
+	entry->index = index;
+	table->count++;
+}
@@ -0,0 +1,43 @@
+#ifndef clox_indices_h
+#define clox_indices_h
+
+#include "common.h"
+
+// An entry of an index table.
+typedef struct {
+	// The entry's key pointer.
+	const void *pointer;
+	
+	// The entry's key number.
+	int number;
+	
+	// The entry's index, or `-1` if the entry is empty.
+	int index;
+} IndexEntry;
+
+// A hash table of indices into an array, keyed by a pointer and a number. Its
+// memory is not managed, so it may be used while the garbage collector runs.
+typedef struct {
+	// The number of entries in the index table.
+	int count;
+	
+	// The current maximum number of entries in the index table.
+	int capacity;
+	
+	// The index table's entries.
+	IndexEntry *entries;
+} IndexTable;
+
+// Initialize an index table.
+void initIndexTable(IndexTable *table);
+
+// Free an index table.
+void freeIndexTable(IndexTable *table);
+
+// Get the index of a key in an index table, or `-1` if the key does not exist.
+int indexTableGet(IndexTable *table, const void *pointer, int number);
+
+// Set the index of a key that does not exist in an index table.
+void indexTableAdd(IndexTable *table, const void *pointer, int number, int index);
+
+#endif // !clox_indices_h
@@ -1,11 +1,25 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#endif // __linux__
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "common.h"
+#include "allocstats.h"
 #include "chunk.h"
+#include "coverage.h"
 #include "debug.h"
+#include "funcstats.h"
+#include "image.h"
+#include "mapping.h"
+#include "profiler.h"
+#include "trace.h"
 #include "vm.h"
+#include "vmstats.h"
 
 #ifdef EXTENSIONS
 #include "extension.h"
@@ -17,6 +31,7 @@ static void repl() {
 	
 	for (;;) {
 		printf("> ");
+		flushOutput();
 		
 		if (!fgets(line, sizeof(line), stdin)) {
 			printf("\n");
@@ -62,9 +77,21 @@ static char *readFile(const char *path) {
 
 // Read and interpret a source file from a path.
 static void runFile(const char *path) {
-	char *source = readFile(path);
+	int mappedLength;
+	char *source = mapFile(path, &mappedLength);
+	bool isMapped = source != NULL;
+	
+	if (!isMapped) {
+		source = readFile(path);
+	}
+	
 	InterpretResult result = interpret(source);
-	free(source);
+	
+	if (isMapped) {
+		unmapFile(source, mappedLength);
+	} else {
+		free(source);
+	}
 	
 	if (result == INTERPRET_COMPILE_ERROR) {
 		exit(65);
@@ -73,32 +100,168 @@ static void runFile(const char *path) {
 	if (result == INTERPRET_RUNTIME_ERROR) {
 		exit(70);
 	}
+	
+	if (isSavingImage()) {
+		fprintf(stderr, "No snapshot reached in \"%s\".\n", path);
+		exit(70);
+	}
+}
+
+// Load and resume interpreting an image from a path.
+static void runImage(const char *path) {
+	if (!loadImage(path)) {
+		fprintf(stderr, "Could not load image \"%s\".\n", path);
+		exit(74);
+	}
+	
+	if (resume() == INTERPRET_RUNTIME_ERROR) {
+		exit(70);
+	}
+}
+
+// Get whether a stream is a terminal.
+static bool isTerminal(FILE *stream) {
+#ifdef __linux__
+	return isatty(fileno(stream)) == 1;
+#else // __linux__
+	(void)stream; // Unused parameter.
+	
+	return true; // Assume a terminal so that output is not delayed.
+#endif // !__linux__
+}
+
+// Give an output stream a buffer of a size, or make it unbuffered if the size
+// is `0`. Terminals are line buffered so that output is not delayed.
+static void setOutputBuffer(FILE *stream, size_t size) {
+	if (size == 0) {
+		setvbuf(stream, NULL, _IONBF, 0);
+	} else {
+		setvbuf(stream, NULL, isTerminal(stream) ? _IOLBF : _IOFBF, size);
+	}
+}
+
+// Give the standard output and error streams buffers of a size, or make them
+// unbuffered if the size is `0`.
+static void setOutputBuffers(size_t size) {
+	setOutputBuffer(stdout, size);
+	setOutputBuffer(stderr, size);
+}
+
+// Print usage information and exit.
+static void usage() {
+#ifdef EXTENSIONS
+	fprintf(stderr, "Usage: clox [<options>...] [<path> [<args>...]]\n");
+#else // EXTENSIONS
+	fprintf(stderr, "Usage: clox [<options>...] [path]\n");
+#endif // !EXTENSIONS
+	
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  --alloc-stats         Print allocation statistics at exit.\n");
+	fprintf(stderr, "  --buffer-size <size>  Set the output buffer size in bytes, or 0 for none (default %d).\n", OUTPUT_BUFFER_DEFAULT);
+	fprintf(stderr, "  --coverage <file>     Write line coverage to <file> and print hot lines at exit.\n");
+	fprintf(stderr, "  --func-stats          Print function call statistics at exit.\n");
+	fprintf(stderr, "  --image               Resume the image at <path>.\n");
+	fprintf(stderr, "  --max-depth <depth>   Set the maximum function call depth (default %d).\n", FRAMES_DEFAULT_MAX);
+	fprintf(stderr, "  --profile <file>      Write sampled call stacks to <file> at exit.\n");
+	fprintf(stderr, "  --save-image <image>  Save an image at the first snapshot.\n");
+	fprintf(stderr, "  --trace-events <file> Write Chrome trace events to <file>.\n");
+	fprintf(stderr, "  --vm-stats <file>     Write VM statistics to <file> at exit.\n");
+	exit(64);
 }
 
 // Interpret a source file from arguments, or run a REPL.
 int main(int argc, const char *argv[]) {
+	int argIndex = 1;
+	bool isImage = false;
+	long bufferSize = OUTPUT_BUFFER_DEFAULT;
+	long maxDepth = FRAMES_DEFAULT_MAX;
+	const char *coveragePath = NULL;
+	const char *profilePath = NULL;
+	const char *traceEventsPath = NULL;
+	const char *vmStatsPath = NULL;
+	
+	for (; argIndex < argc && strncmp(argv[argIndex], "--", 2) == 0; argIndex++) {
+		const char *option = argv[argIndex];
+		
+		if (strcmp(option, "--alloc-stats") == 0) {
+			initAllocationStats();
+		} else if (strcmp(option, "--buffer-size") == 0 && argIndex + 1 < argc) {
+			char *end;
+			bufferSize = strtol(argv[++argIndex], &end, 10);
+			
+			if (*end != '\0' || bufferSize < 0 || bufferSize > OUTPUT_BUFFER_MAX) {
+				usage();
+			}
+		} else if (strcmp(option, "--coverage") == 0 && argIndex + 1 < argc) {
+			coveragePath = argv[++argIndex];
+		} else if (strcmp(option, "--func-stats") == 0) {
+			initFunctionStats();
+		} else if (strcmp(option, "--image") == 0) {
+			isImage = true;
+		} else if (strcmp(option, "--max-depth") == 0 && argIndex + 1 < argc) {
+			char *end;
+			maxDepth = strtol(argv[++argIndex], &end, 10);
+			
+			if (*end != '\0' || maxDepth < 1 || maxDepth > INT32_MAX / UINT8_COUNT) {
+				usage();
+			}
+		} else if (strcmp(option, "--profile") == 0 && argIndex + 1 < argc) {
+			profilePath = argv[++argIndex];
+		} else if (strcmp(option, "--save-image") == 0 && argIndex + 1 < argc) {
+			initImage(argv[++argIndex]);
+		} else if (strcmp(option, "--trace-events") == 0 && argIndex + 1 < argc) {
+			traceEventsPath = argv[++argIndex];
+		} else if (strcmp(option, "--vm-stats") == 0 && argIndex + 1 < argc) {
+			vmStatsPath = argv[++argIndex];
+		} else {
+			usage();
+		}
+	}
+	
+	int argCount = argc - argIndex;
+	setOutputBuffers((size_t)bufferSize);
+	
 #ifdef EXTENSIONS
-	initExtensions(argc, argv);
+	initExtensions(argCount, &argv[argIndex]);
 #endif // EXTENSIONS
 	
 	initVM();
+	vm.maxFrames = (int)maxDepth;
+	
+	if (profilePath != NULL && !initProfiler(profilePath)) {
+		fprintf(stderr, "Could not start profiler \"%s\".\n", profilePath);
+		exit(74);
+	}
 	
-	if (argc == 1) {
+	if (coveragePath != NULL && !initCoverage(coveragePath, argCount > 0 && !isImage ? argv[argIndex] : NULL)) {
+		fprintf(stderr, "Could not open coverage file \"%s\".\n", coveragePath);
+		exit(74);
+	}
+	
+	if (traceEventsPath != NULL && !initTraceEvents(traceEventsPath)) {
+		fprintf(stderr, "Could not open trace events file \"%s\".\n", traceEventsPath);
+		exit(74);
+	}
+	
+	if (vmStatsPath != NULL && !initVMStats(vmStatsPath)) {
+		fprintf(stderr, "Could not open VM stats file \"%s\".\n", vmStatsPath);
+		exit(74);
+	}
+	
+	if (argCount == 0 && !isImage && !isSavingImage()) {
 		repl();
 #ifdef EXTENSIONS
-	} else if (argc > 1) {
+	} else if (argCount > 0) {
 #else // EXTENSIONS
-	} else if (argc == 2) {
+	} else if (argCount == 1) {
 #endif // !EXTENSIONS
-		runFile(argv[1]);
+		if (isImage) {
+			runImage(argv[argIndex]);
+		} else {
+			runFile(argv[argIndex]);
+		}
 	} else {
-#ifdef EXTENSIONS
-		fprintf(stderr, "Usage: clox [<path> [<args>...]]\n");
-#else // EXTENSIONS
-		fprintf(stderr, "Usage: clox [path]\n");
-#endif // !EXTENSIONS
-		
-		exit(64);
+		usage();
 	}
 	
 	freeVM();
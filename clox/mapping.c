@@ -0,0 +1,66 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // __linux__
+
+#include "mapping.h"
+
+#ifdef __linux__
+
+char *mapFile(const char *path, int *length) {
+	int fd = open(path, O_RDONLY);
+	
+	if (fd == -1) {
+		return NULL; // Could not open file.
+	}
+	
+	struct stat status;
+	long pageSize = sysconf(_SC_PAGESIZE);
+	
+	// The zero-filled end of the last page is used as the null terminator, so
+	// files that end on a page boundary can't be mapped.
+	if (
+			fstat(fd, &status) == -1
+			|| !S_ISREG(status.st_mode)
+			|| status.st_size <= 0
+			|| status.st_size >= INT32_MAX
+			|| pageSize <= 0
+			|| status.st_size % pageSize == 0) {
+		close(fd);
+		return NULL;
+	}
+	
+	void *chars = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	
+	if (chars == MAP_FAILED) {
+		return NULL; // Could not map file.
+	}
+	
+	*length = (int)status.st_size;
+	return (char*)chars;
+}
+
+void unmapFile(char *chars, int length) {
+	munmap(chars, (size_t)length);
+}
+
+#else // __linux__
+
+char *mapFile(const char *path, int *length) {
+	(void)path; // Unused parameter.
+	(void)length; // Unused parameter.
+	
+	return NULL; // Mapping is not supported.
+}
+
+void unmapFile(char *chars, int length) {
+	(void)chars; // Unused parameter.
+	(void)length; // Unused parameter.
+}
+
+#endif // !__linux__
@@ -0,0 +1,14 @@
+#ifndef clox_mapping_h
+#define clox_mapping_h
+
+#include "common.h"
+
+// Map a file from a path into read-only memory followed by a null terminator
+// and return it, or return `NULL` if the file could not be mapped. The file's
+// length is written to `length`.
+char *mapFile(const char *path, int *length);
+
+// Unmap a file's memory from its length.
+void unmapFile(char *chars, int length);
+
+#endif // !clox_mapping_h
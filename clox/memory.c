@@ -1,8 +1,16 @@
 #include <stdlib.h>
 
+#include "allocstats.h"
 #include "compiler.h"
+#include "coverage.h"
+#include "funcstats.h"
+#include "image.h"
+#include "mapping.h"
 #include "memory.h"
+#include "timing.h"
+#include "trace.h"
 #include "vm.h"
+#include "vmstats.h"
 
 #ifdef DEBUG_LOG_GC
 #include <stdio.h>
@@ -16,6 +24,14 @@ void *reallocate(void *pointer, size_t oldSize, size_t newSize) {
 	vm.bytesAllocated += newSize - oldSize;
 	
 	if (newSize > oldSize) {
+		if (isRecordingAllocations) {
+			recordBytes(newSize - oldSize);
+		}
+		
+		if (isRecordingVMStats) {
+			recordHeapSize();
+		}
+		
 #ifdef DEBUG_STRESS_GC
 		collectGarbage();
 #endif // DEBUG_STRESS_GC
@@ -46,6 +62,13 @@ static void freeObject(Obj *object) {
 #endif // DEBUG_LOG_GC
 	
 	switch (object->type) {
+		case OBJ_ARRAY: {
+			ObjArray *array = (ObjArray*)object;
+			freeValueArray(&array->elements);
+			FREE(ObjArray, object);
+			break;
+		}
+		
 		case OBJ_BOUND_METHOD: {
 			FREE(ObjBoundMethod, object);
 			break;
@@ -79,6 +102,15 @@ static void freeObject(Obj *object) {
 			break;
 		}
 		
+		case OBJ_MAP: {
+			ObjMap *map = (ObjMap*)object;
+			freeTable(&map->indices);
+			freeValueArray(&map->keys);
+			freeValueArray(&map->values);
+			FREE(ObjMap, object);
+			break;
+		}
+		
 		case OBJ_NATIVE: {
 			FREE(ObjNative, object);
 			break;
@@ -86,11 +118,24 @@ static void freeObject(Obj *object) {
 		
 		case OBJ_STRING: {
 			ObjString *string = (ObjString*)object;
-			FREE_ARRAY(char, string->chars, string->length + 1);
+			
+			if (string->isMapped) {
+				unmapFile(string->chars, string->length);
+			} else {
+				FREE_ARRAY(char, string->chars, string->length + 1);
+			}
+			
 			FREE(ObjString, object);
 			break;
 		}
 		
+		case OBJ_STRING_BUILDER: {
+			ObjStringBuilder *builder = (ObjStringBuilder*)object;
+			FREE_ARRAY(char, builder->chars, builder->capacity);
+			FREE(ObjStringBuilder, object);
+			break;
+		}
+		
 		case OBJ_UPVALUE: {
 			FREE(ObjUpvalue, object);
 			break;
@@ -145,6 +190,12 @@ static void blackenObject(Obj *object) {
 #endif // DEBUG_LOG_GC
 	
 	switch (object->type) {
+		case OBJ_ARRAY: {
+			ObjArray *array = (ObjArray*)object;
+			markArray(&array->elements);
+			break;
+		}
+		
 		case OBJ_BOUND_METHOD: {
 			ObjBoundMethod *bound = (ObjBoundMethod*)object;
 			markValue(bound->receiver);
@@ -183,11 +234,21 @@ static void blackenObject(Obj *object) {
 			break;
 		}
 		
+		case OBJ_MAP: {
+			ObjMap *map = (ObjMap*)object;
+			markArray(&map->keys);
+			markArray(&map->values);
+			break;
+		}
+		
+		case OBJ_NATIVE:
+			markObject((Obj*)((ObjNative*)object)->name);
+			break;
 		case OBJ_UPVALUE:
 			markValue(((ObjUpvalue*)object)->closed);
 			break;
-		case OBJ_NATIVE:
 		case OBJ_STRING:
+		case OBJ_STRING_BUILDER:
 			break; // No references to follow.
 	}
 }
@@ -208,6 +269,10 @@ static void markRoots() {
 	
 	markTable(&vm.globals);
 	markCompilerRoots();
+	markImageRoots();
+	markFunctionStatsRoots();
+	markAllocationStatsRoots();
+	markCoverageRoots();
 	markObject((Obj*)vm.initString);
 }
 
@@ -250,13 +315,33 @@ void collectGarbage() {
 	size_t before = vm.bytesAllocated;
 #endif // DEBUG_LOG_GC
 	
+	uint64_t startTime = isRecordingVMStats ? getNanoseconds() : 0;
+	beginTraceEvent("collectGarbage", "gc");
+	beginTraceEvent("markRoots", "gc");
 	markRoots();
+	endTraceEvent();
+	beginTraceEvent("traceReferences", "gc");
 	traceReferences();
+	endTraceEvent();
+	beginTraceEvent("tableRemoveWhite", "gc");
 	tableRemoveWhite(&vm.strings);
+	endTraceEvent();
+	
+	if (isRecordingAllocations) {
+		recordSurvivors();
+	}
+	
+	beginTraceEvent("sweep", "gc");
 	sweep();
+	endTraceEvent();
+	endTraceEvent();
 	
 	vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
 	
+	if (isRecordingVMStats) {
+		recordCollection(getNanoseconds() - startTime);
+	}
+	
 #ifdef DEBUG_LOG_GC
 	printf("-- gc end\n");
 	printf(
@@ -0,0 +1,416 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "number.h"
+
+// The mask for the significand bits of a double.
+#define DOUBLE_SIGNIFICAND_MASK UINT64_C(0x000fffffffffffff)
+
+// The mask for the exponent bits of a double.
+#define DOUBLE_EXPONENT_MASK UINT64_C(0x7ff0000000000000)
+
+// The implicit leading bit of a normal double's significand.
+#define DOUBLE_HIDDEN_BIT UINT64_C(0x0010000000000000)
+
+// The bias of a double's exponent for an integer significand.
+#define DOUBLE_EXPONENT_BIAS (0x3ff + 52)
+
+// The limit below which every integer is exactly representable as a double.
+#define DOUBLE_INTEGER_LIMIT 9007199254740992.0
+
+// The decimal exponent of the first cached power of ten.
+#define CACHED_POWER_MIN_EXPONENT (-348)
+
+// The decimal exponent step between cached powers of ten.
+#define CACHED_POWER_STEP 8
+
+// The maximum number of digits generated for a number.
+#define DIGITS_MAX 20
+
+// The number of significant digits that always identify a double.
+#define DOUBLE_DIGITS_MAX 17
+
+// A floating-point number with an unsigned 64-bit integer significand.
+typedef struct {
+	// The number's significand.
+	uint64_t significand;
+	
+	// The number's binary exponent.
+	int exponent;
+} DiyFp;
+
+// The normalized powers of ten from 10^-348 to 10^340 in steps of 10^8.
+static const DiyFp cachedPowers[] = {
+	{UINT64_C(0xfa8fd5a0081c0288), -1220}, {UINT64_C(0xbaaee17fa23ebf76), -1193},
+	{UINT64_C(0x8b16fb203055ac76), -1166}, {UINT64_C(0xcf42894a5dce35ea), -1140},
+	{UINT64_C(0x9a6bb0aa55653b2d), -1113}, {UINT64_C(0xe61acf033d1a45df), -1087},
+	{UINT64_C(0xab70fe17c79ac6ca), -1060}, {UINT64_C(0xff77b1fcbebcdc4f), -1034},
+	{UINT64_C(0xbe5691ef416bd60c), -1007}, {UINT64_C(0x8dd01fad907ffc3c), -980},
+	{UINT64_C(0xd3515c2831559a83), -954}, {UINT64_C(0x9d71ac8fada6c9b5), -927},
+	{UINT64_C(0xea9c227723ee8bcb), -901}, {UINT64_C(0xaecc49914078536d), -874},
+	{UINT64_C(0x823c12795db6ce57), -847}, {UINT64_C(0xc21094364dfb5637), -821},
+	{UINT64_C(0x9096ea6f3848984f), -794}, {UINT64_C(0xd77485cb25823ac7), -768},
+	{UINT64_C(0xa086cfcd97bf97f4), -741}, {UINT64_C(0xef340a98172aace5), -715},
+	{UINT64_C(0xb23867fb2a35b28e), -688}, {UINT64_C(0x84c8d4dfd2c63f3b), -661},
+	{UINT64_C(0xc5dd44271ad3cdba), -635}, {UINT64_C(0x936b9fcebb25c996), -608},
+	{UINT64_C(0xdbac6c247d62a584), -582}, {UINT64_C(0xa3ab66580d5fdaf6), -555},
+	{UINT64_C(0xf3e2f893dec3f126), -529}, {UINT64_C(0xb5b5ada8aaff80b8), -502},
+	{UINT64_C(0x87625f056c7c4a8b), -475}, {UINT64_C(0xc9bcff6034c13053), -449},
+	{UINT64_C(0x964e858c91ba2655), -422}, {UINT64_C(0xdff9772470297ebd), -396},
+	{UINT64_C(0xa6dfbd9fb8e5b88f), -369}, {UINT64_C(0xf8a95fcf88747d94), -343},
+	{UINT64_C(0xb94470938fa89bcf), -316}, {UINT64_C(0x8a08f0f8bf0f156b), -289},
+	{UINT64_C(0xcdb02555653131b6), -263}, {UINT64_C(0x993fe2c6d07b7fac), -236},
+	{UINT64_C(0xe45c10c42a2b3b06), -210}, {UINT64_C(0xaa242499697392d3), -183},
+	{UINT64_C(0xfd87b5f28300ca0e), -157}, {UINT64_C(0xbce5086492111aeb), -130},
+	{UINT64_C(0x8cbccc096f5088cc), -103}, {UINT64_C(0xd1b71758e219652c), -77},
+	{UINT64_C(0x9c40000000000000), -50}, {UINT64_C(0xe8d4a51000000000), -24},
+	{UINT64_C(0xad78ebc5ac620000), 3}, {UINT64_C(0x813f3978f8940984), 30},
+	{UINT64_C(0xc097ce7bc90715b3), 56}, {UINT64_C(0x8f7e32ce7bea5c70), 83},
+	{UINT64_C(0xd5d238a4abe98068), 109}, {UINT64_C(0x9f4f2726179a2245), 136},
+	{UINT64_C(0xed63a231d4c4fb27), 162}, {UINT64_C(0xb0de65388cc8ada8), 189},
+	{UINT64_C(0x83c7088e1aab65db), 216}, {UINT64_C(0xc45d1df942711d9a), 242},
+	{UINT64_C(0x924d692ca61be758), 269}, {UINT64_C(0xda01ee641a708dea), 295},
+	{UINT64_C(0xa26da3999aef774a), 322}, {UINT64_C(0xf209787bb47d6b85), 348},
+	{UINT64_C(0xb454e4a179dd1877), 375}, {UINT64_C(0x865b86925b9bc5c2), 402},
+	{UINT64_C(0xc83553c5c8965d3d), 428}, {UINT64_C(0x952ab45cfa97a0b3), 455},
+	{UINT64_C(0xde469fbd99a05fe3), 481}, {UINT64_C(0xa59bc234db398c25), 508},
+	{UINT64_C(0xf6c69a72a3989f5c), 534}, {UINT64_C(0xb7dcbf5354e9bece), 561},
+	{UINT64_C(0x88fcf317f22241e2), 588}, {UINT64_C(0xcc20ce9bd35c78a5), 614},
+	{UINT64_C(0x98165af37b2153df), 641}, {UINT64_C(0xe2a0b5dc971f303a), 667},
+	{UINT64_C(0xa8d9d1535ce3b396), 694}, {UINT64_C(0xfb9b7cd9a4a7443c), 720},
+	{UINT64_C(0xbb764c4ca7a44410), 747}, {UINT64_C(0x8bab8eefb6409c1a), 774},
+	{UINT64_C(0xd01fef10a657842c), 800}, {UINT64_C(0x9b10a4e5e9913129), 827},
+	{UINT64_C(0xe7109bfba19c0c9d), 853}, {UINT64_C(0xac2820d9623bf429), 880},
+	{UINT64_C(0x80444b5e7aa7cf85), 907}, {UINT64_C(0xbf21e44003acdd2d), 933},
+	{UINT64_C(0x8e679c2f5e44ff8f), 960}, {UINT64_C(0xd433179d9c8cb841), 986},
+	{UINT64_C(0x9e19db92b4e31ba9), 1013}, {UINT64_C(0xeb96bf6ebadf77d9), 1039},
+	{UINT64_C(0xaf87023b9bf0ee6b), 1066}
+};
+
+// The powers of ten that fit in an unsigned 64-bit integer.
+static const uint64_t powersOfTen[] = {
+	UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+	UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000),
+	UINT64_C(100000000), UINT64_C(1000000000), UINT64_C(10000000000),
+	UINT64_C(100000000000), UINT64_C(1000000000000),
+	UINT64_C(10000000000000), UINT64_C(100000000000000),
+	UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+	UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+	UINT64_C(10000000000000000000),
+};
+
+// Make a floating-point number from a positive finite double.
+static DiyFp makeDiyFp(double number) {
+	uint64_t bits;
+	memcpy(&bits, &number, sizeof(bits));
+	
+	int biasedExponent = (int)((bits & DOUBLE_EXPONENT_MASK) >> 52);
+	uint64_t significand = bits & DOUBLE_SIGNIFICAND_MASK;
+	
+	if (biasedExponent != 0) {
+		return (DiyFp){significand + DOUBLE_HIDDEN_BIT, biasedExponent - DOUBLE_EXPONENT_BIAS};
+	} else {
+		return (DiyFp){significand, 1 - DOUBLE_EXPONENT_BIAS}; // Subnormal.
+	}
+}
+
+// Normalize a non-zero floating-point number so its significand's highest bit
+// is set.
+static DiyFp normalizeDiyFp(DiyFp number) {
+	while ((number.significand & (UINT64_C(1) << 63)) == 0) {
+		number.significand <<= 1;
+		number.exponent--;
+	}
+	
+	return number;
+}
+
+// Multiply two floating-point numbers, rounding the product's significand.
+static DiyFp multiplyDiyFp(DiyFp x, DiyFp y) {
+	const uint64_t mask = UINT64_C(0xffffffff);
+	uint64_t a = x.significand >> 32;
+	uint64_t b = x.significand & mask;
+	uint64_t c = y.significand >> 32;
+	uint64_t d = y.significand & mask;
+	
+	uint64_t ac = a * c;
+	uint64_t bc = b * c;
+	uint64_t ad = a * d;
+	uint64_t bd = b * d;
+	uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask) + (UINT64_C(1) << 31);
+	
+	return (DiyFp){ac + (ad >> 32) + (bc >> 32) + (middle >> 32), x.exponent + y.exponent + 64};
+}
+
+// Get the normalized lower and upper boundaries of the numbers that round to
+// a floating-point number. Both boundaries have the same exponent.
+static void getBoundaries(DiyFp number, DiyFp *lower, DiyFp *upper) {
+	*upper = normalizeDiyFp((DiyFp){(number.significand << 1) + 1, number.exponent - 1});
+	
+	// The gap below a power of two is half the gap above it.
+	if (number.significand == DOUBLE_HIDDEN_BIT) {
+		*lower = (DiyFp){(number.significand << 2) - 1, number.exponent - 2};
+	} else {
+		*lower = (DiyFp){(number.significand << 1) - 1, number.exponent - 1};
+	}
+	
+	lower->significand <<= lower->exponent - upper->exponent;
+	lower->exponent = upper->exponent;
+}
+
+// Get a cached power of ten that scales a binary exponent into the range
+// [-60, -32] and write its negated decimal exponent to a pointer.
+static DiyFp getCachedPower(int exponent, int *decimalExponent) {
+	double estimate = (-61 - exponent) * 0.30102999566398114 + 347; // log10(2)
+	int k = (int)estimate;
+	
+	if (estimate - k > 0.0) {
+		k++;
+	}
+	
+	int index = (k >> 3) + 1;
+	*decimalExponent = -(CACHED_POWER_MIN_EXPONENT + index * CACHED_POWER_STEP);
+	return cachedPowers[index];
+}
+
+// Round the last generated digit towards the scaled number while the result
+// stays inside the rounding interval, and return whether the digits are
+// guaranteed to be the shortest and closest digits for the number.
+static bool roundDigits(
+		char *digits, int length,
+		uint64_t distance, uint64_t interval, uint64_t rest, uint64_t tenKappa, uint64_t unit) {
+	uint64_t smallDistance = distance - unit;
+	uint64_t bigDistance = distance + unit;
+	
+	while (
+			rest < smallDistance
+			&& interval - rest >= tenKappa
+			&& (rest + tenKappa < smallDistance || smallDistance - rest >= rest + tenKappa - smallDistance)) {
+		digits[length - 1]--;
+		rest += tenKappa;
+	}
+	
+	// Fail if another rounding would be closer to the unscaled number.
+	if (
+			rest < bigDistance
+			&& interval - rest >= tenKappa
+			&& (rest + tenKappa < bigDistance || bigDistance - rest > rest + tenKappa - bigDistance)) {
+		return false;
+	}
+	
+	return 2 * unit <= rest && rest <= interval - 4 * unit;
+}
+
+// Generate the shortest digits inside a scaled rounding interval, widened by
+// the scaling error, and return whether the digits are guaranteed to be
+// correct. The number of digits is written to a pointer, and the digits'
+// decimal exponent is adjusted by the number of digits that were not
+// generated.
+static bool generateDigits(
+		DiyFp lower, DiyFp scaled, DiyFp upper,
+		char *digits, int *length, int *decimalExponent) {
+	uint64_t unit = 1;
+	uint64_t tooHigh = upper.significand + unit;
+	uint64_t interval = tooHigh - (lower.significand - unit);
+	uint64_t distance = tooHigh - scaled.significand;
+	int shift = -scaled.exponent;
+	uint64_t one = UINT64_C(1) << shift;
+	uint32_t integral = (uint32_t)(tooHigh >> shift);
+	uint64_t fractional = tooHigh & (one - 1);
+	int kappa = 1;
+	*length = 0;
+	
+	while (kappa < 10 && integral >= powersOfTen[kappa]) {
+		kappa++;
+	}
+	
+	while (kappa > 0) {
+		uint32_t power = (uint32_t)powersOfTen[kappa - 1];
+		digits[(*length)++] = (char)('0' + integral / power);
+		integral %= power;
+		kappa--;
+		
+		uint64_t rest = ((uint64_t)integral << shift) + fractional;
+		
+		if (rest < interval) {
+			*decimalExponent += kappa;
+			return roundDigits(digits, *length, distance, interval, rest, (uint64_t)power << shift, unit);
+		}
+	}
+	
+	for (;;) {
+		fractional *= 10;
+		unit *= 10;
+		interval *= 10;
+		digits[(*length)++] = (char)('0' + (fractional >> shift));
+		fractional &= one - 1;
+		kappa--;
+		
+		if (fractional < interval) {
+			*decimalExponent += kappa;
+			return roundDigits(digits, *length, distance * unit, interval, fractional, one, unit);
+		}
+	}
+}
+
+// Write the shortest digits of a positive finite number using the exact but
+// slow standard library, and return the number of digits.
+static int getExactDigits(double number, char *digits, int *decimalExponent) {
+	char buffer[DIGITS_MAX + 16];
+	int precision;
+	
+	for (precision = 1; precision < DOUBLE_DIGITS_MAX; precision++) {
+		snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, number);
+		
+		if (strtod(buffer, NULL) == number) {
+			break;
+		}
+	}
+	
+	snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, number);
+	
+	int length = 0;
+	char *exponent = strchr(buffer, 'e');
+	
+	for (char *current = buffer; current < exponent; current++) {
+		if (*current != '.') {
+			digits[length++] = *current;
+		}
+	}
+	
+	while (length > 1 && digits[length - 1] == '0') {
+		length--; // Strip trailing zeroes.
+	}
+	
+	*decimalExponent = atoi(exponent + 1) - length + 1;
+	return length;
+}
+
+// Write the shortest digits of a positive finite number using the Grisu3
+// algorithm, and return the number of digits. The number is the digits times
+// 10 to the power of the decimal exponent. Falls back to the standard library
+// for the rare numbers that Grisu3 can't prove correct.
+static int getDigits(double number, char *digits, int *decimalExponent) {
+	DiyFp value = makeDiyFp(number);
+	DiyFp lower;
+	DiyFp upper;
+	getBoundaries(value, &lower, &upper);
+	
+	DiyFp power = getCachedPower(upper.exponent, decimalExponent);
+	DiyFp scaled = multiplyDiyFp(normalizeDiyFp(value), power);
+	DiyFp scaledLower = multiplyDiyFp(lower, power);
+	DiyFp scaledUpper = multiplyDiyFp(upper, power);
+	int length;
+	
+	if (!generateDigits(scaledLower, scaled, scaledUpper, digits, &length, decimalExponent)) {
+		length = getExactDigits(number, digits, decimalExponent);
+	}
+	
+	return length;
+}
+
+// Write the digits of an integer to a buffer and return the number of digits.
+static int getIntegerDigits(uint64_t integer, char *digits) {
+	char reversed[DIGITS_MAX];
+	int length = 0;
+	
+	do {
+		reversed[length++] = (char)('0' + integer % 10);
+		integer /= 10;
+	} while (integer != 0);
+	
+	for (int i = 0; i < length; i++) {
+		digits[i] = reversed[length - 1 - i];
+	}
+	
+	return length;
+}
+
+// Write a number of zeroes to a buffer and return the end of the buffer.
+static char *writeZeroes(char *buffer, int count) {
+	memset(buffer, '0', (size_t)count);
+	return buffer + count;
+}
+
+// Write digits with a decimal exponent to a buffer without an exponent and
+// return the end of the buffer.
+static char *writeDecimal(char *buffer, const char *digits, int length, int decimalExponent) {
+	int point = length + decimalExponent;
+	
+	if (decimalExponent >= 0) {
+		memcpy(buffer, digits, (size_t)length);
+		return writeZeroes(buffer + length, decimalExponent);
+	} else if (point > 0) {
+		memcpy(buffer, digits, (size_t)point);
+		buffer[point] = '.';
+		memcpy(buffer + point + 1, digits + point, (size_t)(length - point));
+		return buffer + length + 1;
+	} else {
+		*buffer++ = '0';
+		*buffer++ = '.';
+		buffer = writeZeroes(buffer, -point);
+		memcpy(buffer, digits, (size_t)length);
+		return buffer + length;
+	}
+}
+
+// Write digits with a decimal exponent to a buffer with an exponent and
+// return the end of the buffer.
+static char *writeExponent(char *buffer, const char *digits, int length, int decimalExponent) {
+	int exponent = length + decimalExponent - 1;
+	*buffer++ = digits[0];
+	
+	if (length > 1) {
+		*buffer++ = '.';
+		memcpy(buffer, digits + 1, (size_t)(length - 1));
+		buffer += length - 1;
+	}
+	
+	*buffer++ = 'e';
+	*buffer++ = exponent < 0 ? '-' : '+';
+	
+	char exponentDigits[DIGITS_MAX];
+	int exponentLength = getIntegerDigits((uint64_t)abs(exponent), exponentDigits);
+	memcpy(buffer, exponentDigits, (size_t)exponentLength);
+	return buffer + exponentLength;
+}
+
+int formatNumber(double number, char *buffer, bool isExponentAllowed) {
+	char *end = buffer;
+	
+	if (isnan(number)) {
+		memcpy(end, "nan", 3);
+		end += 3;
+	} else {
+		if (signbit(number)) {
+			*end++ = '-';
+			number = -number;
+		}
+		
+		char digits[DIGITS_MAX];
+		int length;
+		int decimalExponent = 0;
+		
+		if (isinf(number)) {
+			memcpy(end, "inf", 3);
+			end += 3;
+		} else if (number < DOUBLE_INTEGER_LIMIT && number == (double)(uint64_t)number) {
+			length = getIntegerDigits((uint64_t)number, digits); // Integer fast path.
+			end = writeDecimal(end, digits, length, decimalExponent);
+		} else {
+			length = getDigits(number, digits, &decimalExponent);
+			int point = length + decimalExponent;
+			
+			if (isExponentAllowed && (point <= -6 || point > 21)) {
+				end = writeExponent(end, digits, length, decimalExponent);
+			} else {
+				end = writeDecimal(end, digits, length, decimalExponent);
+			}
+		}
+	}
+	
+	*end = '\0';
+	return (int)(end - buffer);
+}
@@ -0,0 +1,15 @@
+#ifndef clox_number_h
+#define clox_number_h
+
+#include "common.h"
+
+// The buffer size needed to format any number, including its null terminator.
+#define NUMBER_BUFFER_SIZE 328
+
+// Write the shortest string that reads back as a number to a buffer of at
+// least `NUMBER_BUFFER_SIZE` bytes and return its length. If exponents are
+// allowed, numbers outside of the range 1e-6 <= |x| < 1e21 are written with an
+// exponent. Otherwise, all digits are written.
+int formatNumber(double number, char *buffer, bool isExponentAllowed);
+
+#endif // !clox_number_h
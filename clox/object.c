@@ -1,6 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "allocstats.h"
+#include "mapping.h"
 #include "memory.h"
 #include "object.h"
 #include "table.h"
@@ -19,6 +22,10 @@ static Obj *allocateObject(size_t size, ObjType type) {
 	object->next = vm.objects;
 	vm.objects = object;
 	
+	if (isRecordingAllocations) {
+		recordObject(object);
+	}
+	
 #ifdef DEBUG_LOG_GC
 	printf("%p allocate %zu for %d\n", (void*)object, size, type);
 #endif // DEBUG_LOG_GC
@@ -26,6 +33,12 @@ static Obj *allocateObject(size_t size, ObjType type) {
 	return object;
 }
 
+ObjArray *newArray() {
+	ObjArray *array = ALLOCATE_OBJ(ObjArray, OBJ_ARRAY);
+	initValueArray(&array->elements);
+	return array;
+}
+
 ObjBoundMethod *newBoundMethod(Value receiver, ObjClosure *method) {
 	ObjBoundMethod *bound = ALLOCATE_OBJ(ObjBoundMethod, OBJ_BOUND_METHOD);
 	bound->receiver = receiver;
@@ -60,6 +73,7 @@ static ObjString *allocateString(char *chars, int length, uint32_t hash) {
 	string->length = length;
 	string->chars = chars;
 	string->hash = hash;
+	string->isMapped = false;
 	
 	push(OBJ_VAL(string));
 	tableSet(&vm.strings, string, NIL_VAL);
@@ -72,6 +86,8 @@ ObjFunction *newFunction() {
 	ObjFunction *function = ALLOCATE_OBJ(ObjFunction, OBJ_FUNCTION);
 	function->arity = 0;
 	function->upvalueCount = 0;
+	function->slotCount = 0;
+	function->line = 0;
 	function->name = NULL;
 	initChunk(&function->chunk);
 	return function;
@@ -84,14 +100,117 @@ ObjInstance *newInstance(ObjClass *klass) {
 	return instance;
 }
 
-ObjNative *newNative(NativeFn function) {
+ObjMap *newMap() {
+	ObjMap *map = ALLOCATE_OBJ(ObjMap, OBJ_MAP);
+	initTable(&map->indices);
+	initValueArray(&map->keys);
+	initValueArray(&map->values);
+	map->count = 0;
+	return map;
+}
+
+bool mapGet(ObjMap *map, Value key, Value *value) {
+	Value index;
+	
+	if (!tableGetValue(&map->indices, key, &index)) {
+		return false;
+	}
+	
+	*value = map->values.values[(int)AS_NUMBER(index)];
+	return true;
+}
+
+bool mapSet(ObjMap *map, Value key, Value value) {
+	if (IS_NIL(key)) {
+		return false; // Nil marks removed key slots.
+	}
+	
+	Value index;
+	
+	if (tableGetValue(&map->indices, key, &index)) {
+		map->values.values[(int)AS_NUMBER(index)] = value;
+		return true;
+	}
+	
+	tableSetValue(&map->indices, key, NUMBER_VAL(map->keys.count));
+	writeValueArray(&map->keys, key);
+	writeValueArray(&map->values, value);
+	map->count++;
+	return true;
+}
+
+// Remove the removed key slots from a map object.
+static void compactMap(ObjMap *map) {
+	int count = 0;
+	
+	for (int i = 0; i < map->keys.count; i++) {
+		Value key = map->keys.values[i];
+		
+		if (IS_NIL(key)) {
+			continue;
+		}
+		
+		map->keys.values[count] = key;
+		map->values.values[count] = map->values.values[i];
+		tableSetValue(&map->indices, key, NUMBER_VAL(count));
+		count++;
+	}
+	
+	map->keys.count = count;
+	map->values.count = count;
+}
+
+bool mapDelete(ObjMap *map, Value key) {
+	Value index;
+	
+	if (!tableGetValue(&map->indices, key, &index)) {
+		return false;
+	}
+	
+	int slot = (int)AS_NUMBER(index);
+	tableDeleteValue(&map->indices, key);
+	map->keys.values[slot] = NIL_VAL;
+	map->values.values[slot] = NIL_VAL;
+	map->count--;
+	
+	// Compact once at least half of the key slots are removed.
+	if (map->keys.count - map->count >= map->count) {
+		compactMap(map);
+	}
+	
+	return true;
+}
+
+ObjNative *newNative(NativeFn function, const char *signature, ObjString *name) {
 	ObjNative *native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
 	native->function = function;
+	native->signature = signature;
+	native->arity = (int)strlen(signature);
+	native->name = name;
 	return native;
 }
 
-// Get a hash from a string slice using FNV-1a.
-static uint32_t hashString(const char *key, int length) {
+char *copyFunctionName(Obj *function) {
+	const char *name = "script";
+	
+	if (function->type == OBJ_NATIVE) {
+		name = ((ObjNative*)function)->name->chars;
+	} else if (((ObjFunction*)function)->name != NULL) {
+		name = ((ObjFunction*)function)->name->chars;
+	}
+	
+	size_t length = strlen(name);
+	char *copy = (char*)malloc(length + 1);
+	
+	if (copy == NULL) {
+		exit(1);
+	}
+	
+	memcpy(copy, name, length + 1);
+	return copy;
+}
+
+uint32_t hashString(const char *key, int length) {
 	uint32_t hash = 2166136261u;
 	
 	for (int i = 0; i < length; i++) {
@@ -114,6 +233,20 @@ ObjString *takeString(char *chars, int length) {
 	return allocateString(chars, length, hash);
 }
 
+ObjString *takeMappedString(char *chars, int length) {
+	uint32_t hash = hashString(chars, length);
+	ObjString *interned = tableFindString(&vm.strings, chars, length, hash);
+	
+	if (interned != NULL) {
+		unmapFile(chars, length);
+		return interned;
+	}
+	
+	ObjString *string = allocateString(chars, length, hash);
+	string->isMapped = true;
+	return string;
+}
+
 ObjString *copyString(const char *chars, int length) {
 	uint32_t hash = hashString(chars, length);
 	ObjString *interned = tableFindString(&vm.strings, chars, length, hash);
@@ -128,6 +261,39 @@ ObjString *copyString(const char *chars, int length) {
 	return allocateString(heapChars, length, hash);
 }
 
+ObjStringBuilder *newStringBuilder() {
+	ObjStringBuilder *builder = ALLOCATE_OBJ(ObjStringBuilder, OBJ_STRING_BUILDER);
+	builder->length = 0;
+	builder->capacity = 0;
+	builder->chars = NULL;
+	return builder;
+}
+
+bool appendStringBuilder(ObjStringBuilder *builder, const char *chars, int length) {
+	// Leave room for the null terminator of a string built from the bytes.
+	if (length > INT32_MAX - 1 - builder->length) {
+		return false;
+	}
+	
+	int required = builder->length + length;
+	
+	if (builder->capacity < required) {
+		int oldCapacity = builder->capacity;
+		int capacity = oldCapacity;
+		
+		while (capacity < required) {
+			capacity = capacity > INT32_MAX / 2 ? INT32_MAX : GROW_CAPACITY(capacity);
+		}
+		
+		builder->chars = GROW_ARRAY(char, builder->chars, oldCapacity, capacity);
+		builder->capacity = capacity;
+	}
+	
+	memcpy(&builder->chars[builder->length], chars, (size_t)length);
+	builder->length = required;
+	return true;
+}
+
 ObjUpvalue *newUpvalue(Value *slot) {
 	ObjUpvalue *upvalue = ALLOCATE_OBJ(ObjUpvalue, OBJ_UPVALUE);
 	upvalue->closed = NIL_VAL;
@@ -147,13 +313,16 @@ static void printFunction(ObjFunction *function) {
 
 void printObject(Value value) {
 	switch (OBJ_TYPE(value)) {
+		case OBJ_ARRAY: printf("<array>"); break;
 		case OBJ_BOUND_METHOD: printFunction(AS_BOUND_METHOD(value)->method->function); break;
 		case OBJ_CLASS: printf("%s", AS_CLASS(value)->name->chars); break;
 		case OBJ_CLOSURE: printFunction(AS_CLOSURE(value)->function); break;
 		case OBJ_FUNCTION: printFunction(AS_FUNCTION(value)); break;
 		case OBJ_INSTANCE: printf("%s instance", AS_INSTANCE(value)->klass->name->chars); break;
+		case OBJ_MAP: printf("<map>"); break;
 		case OBJ_NATIVE: printf("<native fn>"); break;
 		case OBJ_STRING: printf("%s", AS_CSTRING(value)); break;
+		case OBJ_STRING_BUILDER: printf("<string builder>"); break;
 		case OBJ_UPVALUE: printf("upvalue"); break;
 	}
 }
@@ -9,6 +9,9 @@
 // Get a value's object type.
 #define OBJ_TYPE(value) (AS_OBJ(value)->type)
 
+// Get whether a value is an array object.
+#define IS_ARRAY(value) isObjType(value, OBJ_ARRAY)
+
 // Get whether a value is a bound method object.
 #define IS_BOUND_METHOD(value) isObjType(value, OBJ_BOUND_METHOD)
 
@@ -24,12 +27,21 @@
 // Get whether a value is an instance object.
 #define IS_INSTANCE(value) isObjType(value, OBJ_INSTANCE)
 
+// Get whether a value is a map object.
+#define IS_MAP(value) isObjType(value, OBJ_MAP)
+
 // Get whether a value is a native object.
 #define IS_NATIVE(value) isObjType(value, OBJ_NATIVE)
 
 // Get whether a value is a string object.
 #define IS_STRING(value) isObjType(value, OBJ_STRING)
 
+// Get whether a value is a string builder object.
+#define IS_STRING_BUILDER(value) isObjType(value, OBJ_STRING_BUILDER)
+
+// Get an array value as an array object.
+#define AS_ARRAY(value) ((ObjArray*)AS_OBJ(value))
+
 // Get a bound method value as a bound method object.
 #define AS_BOUND_METHOD(value) ((ObjBoundMethod*)AS_OBJ(value))
 
@@ -45,8 +57,11 @@
 // Get an instance value as an instance object.
 #define AS_INSTANCE(value) ((ObjInstance*)AS_OBJ(value))
 
-// Get a native value as a native function pointer.
-#define AS_NATIVE(value) (((ObjNative*)AS_OBJ(value))->function)
+// Get a map value as a map object.
+#define AS_MAP(value) ((ObjMap*)AS_OBJ(value))
+
+// Get a native value as a native object.
+#define AS_NATIVE(value) ((ObjNative*)AS_OBJ(value))
 
 // Get a string value as a string object.
 #define AS_STRING(value) ((ObjString*)AS_OBJ(value))
@@ -54,8 +69,14 @@
 // Get a string value as a character pointer.
 #define AS_CSTRING(value) (((ObjString*)AS_OBJ(value))->chars)
 
+// Get a string builder value as a string builder object.
+#define AS_STRING_BUILDER(value) ((ObjStringBuilder*)AS_OBJ(value))
+
 // An object's type.
 typedef enum {
+	// An array object's type.
+	OBJ_ARRAY,
+	
 	// A bound method object's type.
 	OBJ_BOUND_METHOD,
 	
@@ -71,12 +92,18 @@ typedef enum {
 	// An instance object's type.
 	OBJ_INSTANCE,
 	
+	// A map object's type.
+	OBJ_MAP,
+	
 	// A native object's type.
 	OBJ_NATIVE,
 	
 	// A string object's type.
 	OBJ_STRING,
 	
+	// A string builder object's type.
+	OBJ_STRING_BUILDER,
+	
 	// An upvalue object's type.
 	OBJ_UPVALUE,
 } ObjType;
@@ -103,6 +130,12 @@ typedef struct {
 	// The number of upvalues used by the function.
 	int upvalueCount;
 	
+	// The maximum number of stack slots used by the function's locals.
+	int slotCount;
+	
+	// The line the function was declared on, or `0` for the script.
+	int line;
+	
 	// The function's bytecode chunk.
 	Chunk chunk;
 	
@@ -110,8 +143,9 @@ typedef struct {
 	ObjString *name;
 } ObjFunction;
 
-// An externally-defined function that can be called from Lox.
-typedef Value (*NativeFn)(int argCount, Value *args);
+// An externally-defined function that can be called from Lox with arguments
+// that match its signature.
+typedef Value (*NativeFn)(Value *args);
 
 // A native heap object.
 typedef struct {
@@ -120,6 +154,17 @@ typedef struct {
 	
 	// The native's function.
 	NativeFn function;
+	
+	// The native's signature, with a type code for each parameter. Type codes
+	// are `a` for arrays, `b` for string builders, `m` for maps, `n` for
+	// numbers, `s` for strings, and `*` for any value.
+	const char *signature;
+	
+	// The native's number of parameters.
+	int arity;
+	
+	// The native's name.
+	ObjString *name;
 } ObjNative;
 
 struct ObjString {
@@ -134,8 +179,26 @@ struct ObjString {
 	
 	// The string's hash.
 	uint32_t hash;
+	
+	// Whether the string's characters are memory-mapped from a file.
+	bool isMapped;
 };
 
+// A growable byte buffer heap object for building strings.
+typedef struct {
+	// The string builder's parent object.
+	Obj obj;
+	
+	// The string builder's number of bytes.
+	int length;
+	
+	// The string builder's current maximum number of bytes.
+	int capacity;
+	
+	// The string builder's bytes.
+	char *chars;
+} ObjStringBuilder;
+
 // An upvalue heap object.
 typedef struct ObjUpvalue {
 	// The upvalue's parent object.
@@ -190,6 +253,33 @@ typedef struct {
 	Table fields;
 } ObjInstance;
 
+// A growable array heap object.
+typedef struct {
+	// The array's parent object.
+	Obj obj;
+	
+	// The array's elements.
+	ValueArray elements;
+} ObjArray;
+
+// An insertion-ordered hash map heap object.
+typedef struct {
+	// The map's parent object.
+	Obj obj;
+	
+	// The map's table of keys to their indices in the map's slots.
+	Table indices;
+	
+	// The map's key slots in insertion order, with nil for removed keys.
+	ValueArray keys;
+	
+	// The map's value slots, parallel to the map's key slots.
+	ValueArray values;
+	
+	// The map's number of keys.
+	int count;
+} ObjMap;
+
 // A bound method heap object.
 typedef struct {
 	// The bound method's parent object.
@@ -202,6 +292,9 @@ typedef struct {
 	ObjClosure *method;
 } ObjBoundMethod;
 
+// Make a new empty array object.
+ObjArray *newArray();
+
 // Make a new bound method.
 ObjBoundMethod *newBoundMethod(Value receiver, ObjClosure *method);
 
@@ -217,15 +310,46 @@ ObjFunction *newFunction();
 // Make a new instance object.
 ObjInstance *newInstance(ObjClass *klass);
 
-// Make a new native object.
-ObjNative *newNative(NativeFn function);
+// Make a new empty map object.
+ObjMap *newMap();
+
+// Get a value from a map object from its key in a pointer and return whether
+// it exists.
+bool mapGet(ObjMap *map, Value key, Value *value);
+
+// Set a key-value pair in a map object and return whether it was successful.
+// New keys are ordered after existing keys. Nil keys are not supported.
+bool mapSet(ObjMap *map, Value key, Value value);
+
+// Remove a key from a map object and return whether it existed.
+bool mapDelete(ObjMap *map, Value key);
+
+// Make a new native object from its function, signature, and name.
+ObjNative *newNative(NativeFn function, const char *signature, ObjString *name);
+
+// Copy the name of a function or native object to memory that is not managed,
+// so that it can be used after the object is freed.
+char *copyFunctionName(Obj *function);
+
+// Get a hash from a string slice using FNV-1a.
+uint32_t hashString(const char *key, int length);
 
 // Get a string object from an owned string.
 ObjString *takeString(char *chars, int length);
 
+// Get a string object from an owned memory-mapped file.
+ObjString *takeMappedString(char *chars, int length);
+
 // Get a string object from a copied slice of a string.
 ObjString *copyString(const char *chars, int length);
 
+// Make a new empty string builder object.
+ObjStringBuilder *newStringBuilder();
+
+// Append bytes to a string builder object and return whether they fit in the
+// maximum string length.
+bool appendStringBuilder(ObjStringBuilder *builder, const char *chars, int length);
+
 // Make a new upvalue object.
 ObjUpvalue *newUpvalue(Value *slot);
 
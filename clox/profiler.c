@@ -0,0 +1,255 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+
+#include <sys/time.h>
+#endif // __linux__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "vm.h"
+
+// The profiler's sampling interval in microseconds of CPU time.
+#define PROFILE_INTERVAL 1000
+
+// The maximum load factor of the sampled folded call stacks.
+#define PROFILE_MAX_LOAD 0.75
+
+// A folded call stack and its number of samples.
+typedef struct {
+	// The entry's folded call stack, or `NULL` if the entry is empty.
+	char *stack;
+	
+	// The hash of the entry's folded call stack.
+	uint32_t hash;
+	
+	// The entry's number of samples.
+	int count;
+} ProfileEntry;
+
+volatile sig_atomic_t isProfileSampleDue = 0;
+
+// The sampled folded call stacks.
+static ProfileEntry *profileEntries = NULL;
+
+// The number of sampled folded call stacks.
+static int profileCount = 0;
+
+// The current maximum number of sampled folded call stacks.
+static int profileCapacity = 0;
+
+// The buffer for building a folded call stack.
+static char *stackChars = NULL;
+
+// The length of the folded call stack being built.
+static size_t stackLength = 0;
+
+// The current maximum length of the folded call stack being built.
+static size_t stackCapacity = 0;
+
+// Append characters to the folded call stack being built.
+static void appendStack(const char *chars, size_t length) {
+	if (stackCapacity < stackLength + length + 1) {
+		while (stackCapacity < stackLength + length + 1) {
+			stackCapacity = stackCapacity < 256 ? 256 : stackCapacity * 2;
+		}
+		
+		stackChars = (char*)realloc(stackChars, stackCapacity);
+		
+		if (stackChars == NULL) {
+			exit(1);
+		}
+	}
+	
+	memcpy(&stackChars[stackLength], chars, length);
+	stackLength += length;
+	stackChars[stackLength] = '\0';
+}
+
+// Get a hash from a folded call stack using FNV-1a.
+static uint32_t hashStack(const char *chars, size_t length) {
+	uint32_t hash = 2166136261u;
+	
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (uint8_t)chars[i];
+		hash *= 16777619;
+	}
+	
+	return hash;
+}
+
+// Find an entry for a folded call stack from its hash in an array of entries.
+static ProfileEntry *findEntry(ProfileEntry *entries, int capacity, const char *stack, uint32_t hash) {
+	uint32_t index = hash & (uint32_t)(capacity - 1);
+	
+	for (;;) {
+		ProfileEntry *entry = &entries[index];
+		
+		if (entry->stack == NULL || (entry->hash == hash && strcmp(entry->stack, stack) == 0)) {
+			return entry;
+		}
+		
+		index = (index + 1) & (uint32_t)(capacity - 1);
+	}
+}
+
+// Grow the sampled folded call stacks to a capacity.
+static void growEntries(int capacity) {
+	ProfileEntry *entries = (ProfileEntry*)calloc((size_t)capacity, sizeof(ProfileEntry));
+	
+	if (entries == NULL) {
+		exit(1);
+	}
+	
+	for (int i = 0; i < profileCapacity; i++) {
+		ProfileEntry *entry = &profileEntries[i];
+		
+		if (entry->stack != NULL) {
+			*findEntry(entries, capacity, entry->stack, entry->hash) = *entry;
+		}
+	}
+	
+	free(profileEntries);
+	profileEntries = entries;
+	profileCapacity = capacity;
+}
+
+#ifdef __linux__
+
+// The file to write folded call stacks to at exit.
+static FILE *profileFile = NULL;
+
+// Compare two entries by their folded call stacks.
+static int compareEntries(const void *a, const void *b) {
+	return strcmp(((const ProfileEntry*)a)->stack, ((const ProfileEntry*)b)->stack);
+}
+
+// Write the sampled folded call stacks to the profile file and free them.
+static void writeProfile() {
+	isProfileSampleDue = 0;
+	int count = 0;
+	
+	for (int i = 0; i < profileCapacity; i++) {
+		if (profileEntries[i].stack != NULL) {
+			profileEntries[count++] = profileEntries[i];
+		}
+	}
+	
+	qsort(profileEntries, (size_t)count, sizeof(ProfileEntry), compareEntries);
+	
+	for (int i = 0; i < count; i++) {
+		fprintf(profileFile, "%s %d\n", profileEntries[i].stack, profileEntries[i].count);
+		free(profileEntries[i].stack);
+	}
+	
+	if (fclose(profileFile) == EOF) {
+		fprintf(stderr, "Could not write profile.\n");
+	}
+	
+	free(profileEntries);
+	free(stackChars);
+	profileFile = NULL;
+	profileEntries = NULL;
+	profileCount = 0;
+	profileCapacity = 0;
+	stackChars = NULL;
+	stackLength = 0;
+	stackCapacity = 0;
+}
+
+// Request a sample of the call stack when the profiler's timer expires.
+static void handleProfileSignal(int signal) {
+	(void)signal; // Unused parameter.
+	
+	isProfileSampleDue = 1;
+}
+
+bool initProfiler(const char *path) {
+	profileFile = fopen(path, "wb");
+	
+	if (profileFile == NULL) {
+		return false; // Could not open profile file.
+	}
+	
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = handleProfileSignal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	
+	struct itimerval timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = PROFILE_INTERVAL;
+	timer.it_value = timer.it_interval;
+	
+	if (sigaction(SIGPROF, &action, NULL) == -1 || setitimer(ITIMER_PROF, &timer, NULL) == -1) {
+		fclose(profileFile);
+		profileFile = NULL;
+		return false; // Could not start timer.
+	}
+	
+	atexit(writeProfile);
+	return true;
+}
+
+#else // __linux__
+
+bool initProfiler(const char *path) {
+	(void)path; // Unused parameter.
+	
+	return false; // Profiling is not supported.
+}
+
+#endif // !__linux__
+
+void sampleProfile() {
+	isProfileSampleDue = 0;
+	stackLength = 0;
+	
+	for (int i = 0; i < vm.frameCount; i++) {
+		CallFrame *frame = &vm.frames[i];
+		ObjFunction *function = frame->closure->function;
+		int offset = (int)(frame->ip - function->chunk.code);
+		
+		// Caller frames are past their call instruction, but the top frame is
+		// at the start of its next instruction.
+		if (i < vm.frameCount - 1) {
+			offset--;
+		}
+		
+		const char *name = function->name == NULL ? "script" : function->name->chars;
+		char line[16];
+		int lineLength = snprintf(line, sizeof(line), ":%d", getLine(&function->chunk, offset));
+		
+		if (i > 0) {
+			appendStack(";", 1);
+		}
+		
+		appendStack(name, strlen(name));
+		appendStack(line, (size_t)lineLength);
+	}
+	
+	if (profileCount + 1 > profileCapacity * PROFILE_MAX_LOAD) {
+		growEntries(profileCapacity < 64 ? 64 : profileCapacity * 2);
+	}
+	
+	uint32_t hash = hashStack(stackChars, stackLength);
+	ProfileEntry *entry = findEntry(profileEntries, profileCapacity, stackChars, hash);
+	
+	if (entry->stack == NULL) {
+		entry->stack = (char*)malloc(stackLength + 1);
+		
+		if (entry->stack == NULL) {
+			exit(1);
+		}
+		
+		memcpy(entry->stack, stackChars, stackLength + 1);
+		entry->hash = hash;
+		entry->count = 0;
+		profileCount++;
+	}
+	
+	entry->count++;
+}
@@ -0,0 +1,18 @@
+#ifndef clox_profiler_h
+#define clox_profiler_h
+
+#include <signal.h>
+
+#include "common.h"
+
+// Whether the profiler's timer has requested a sample of the call stack.
+extern volatile sig_atomic_t isProfileSampleDue;
+
+// Start sampling the call stack to write as folded stacks to a path at exit,
+// and return whether profiling was started.
+bool initProfiler(const char *path);
+
+// Record a sample of the current call stack.
+void sampleProfile();
+
+#endif // !clox_profiler_h
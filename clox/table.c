@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -20,21 +21,54 @@ void freeTable(Table *table) {
 	initTable(table);
 }
 
-// Find an entry in an entry array from its key.
-static Entry *findEntry(Entry *entries, int capacity, ObjString *key) {
-	uint32_t index = key->hash & (capacity - 1);
+// Mix the bits of a 64-bit integer into a 32-bit hash.
+static uint32_t hashBits(uint64_t bits) {
+	bits = ~bits + (bits << 18);
+	bits ^= bits >> 31;
+	bits *= 21;
+	bits ^= bits >> 11;
+	bits += bits << 6;
+	bits ^= bits >> 22;
+	return (uint32_t)bits;
+}
+
+// Hash a value key. Strings are hashed by their characters, numbers by their
+// value, and other objects by their identity.
+static uint32_t hashValue(Value key) {
+	if (IS_STRING(key)) {
+		return AS_STRING(key)->hash;
+	} else if (IS_OBJ(key)) {
+		return hashBits((uint64_t)(uintptr_t)AS_OBJ(key));
+	} else if (IS_NUMBER(key)) {
+		double number = AS_NUMBER(key);
+		uint64_t bits;
+		
+		if (number == 0) {
+			number = 0; // Hash -0 like 0 because they are equal.
+		}
+		
+		memcpy(&bits, &number, sizeof(bits));
+		return hashBits(bits);
+	} else {
+		return IS_BOOL(key) && AS_BOOL(key) ? 1 : 0;
+	}
+}
+
+// Find an entry in an entry array from its key and the key's hash.
+static Entry *findEntry(Entry *entries, int capacity, Value key, uint32_t hash) {
+	uint32_t index = hash & (capacity - 1);
 	Entry *tombstone = NULL;
 	
 	for (;;) {
 		Entry *entry = &entries[index];
 		
-		if (entry->key == NULL) {
+		if (IS_NIL(entry->key)) {
 			if (IS_NIL(entry->value)) {
 				return tombstone != NULL ? tombstone : entry;
 			} else if (tombstone == NULL) {
 				tombstone = entry; // Don't stop at tombstones.
 			}
-		} else if (entry->key == key) {
+		} else if (valuesEqual(entry->key, key)) {
 			return entry;
 		}
 		
@@ -42,14 +76,16 @@ static Entry *findEntry(Entry *entries, int capacity, ObjString *key) {
 	}
 }
 
-bool tableGet(Table *table, ObjString *key, Value *value) {
+// Get a value from a hash table from a key and its hash in a pointer and
+// return whether it exists.
+static bool getEntry(Table *table, Value key, uint32_t hash, Value *value) {
 	if (table->count == 0) {
 		return false;
 	}
 	
-	Entry *entry = findEntry(table->entries, table->capacity, key);
+	Entry *entry = findEntry(table->entries, table->capacity, key, hash);
 	
-	if (entry->key == NULL) {
+	if (IS_NIL(entry->key)) {
 		return false;
 	}
 	
@@ -57,12 +93,20 @@ bool tableGet(Table *table, ObjString *key, Value *value) {
 	return true;
 }
 
+bool tableGet(Table *table, ObjString *key, Value *value) {
+	return getEntry(table, OBJ_VAL(key), key->hash, value);
+}
+
+bool tableGetValue(Table *table, Value key, Value *value) {
+	return getEntry(table, key, hashValue(key), value);
+}
+
 // Reallocate a hash table to a new capacity.
 static void adjustCapacity(Table *table, int capacity) {
 	Entry *entries = ALLOCATE(Entry, capacity);
 	
 	for (int i = 0; i < capacity; i++) {
-		entries[i].key = NULL;
+		entries[i].key = NIL_VAL;
 		entries[i].value = NIL_VAL;
 	}
 	
@@ -71,11 +115,11 @@ static void adjustCapacity(Table *table, int capacity) {
 	for (int i = 0; i < table->capacity; i++) {
 		Entry *entry = &table->entries[i];
 		
-		if (entry->key == NULL) {
+		if (IS_NIL(entry->key)) {
 			continue;
 		}
 		
-		Entry *dest = findEntry(entries, capacity, entry->key);
+		Entry *dest = findEntry(entries, capacity, entry->key, hashValue(entry->key));
 		dest->key = entry->key;
 		dest->value = entry->value;
 		table->count++;
@@ -86,14 +130,16 @@ static void adjustCapacity(Table *table, int capacity) {
 	table->capacity = capacity;
 }
 
-bool tableSet(Table *table, ObjString *key, Value value) {
+// Set an entry in a hash table from a key and its hash and return whether it
+// is new.
+static bool setEntry(Table *table, Value key, uint32_t hash, Value value) {
 	if (table->count + 1 > table->capacity * TABLE_MAX_LOAD) {
 		int capacity = GROW_CAPACITY(table->capacity);
 		adjustCapacity(table, capacity);
 	}
 	
-	Entry *entry = findEntry(table->entries, table->capacity, key);
-	bool isNewKey = entry->key == NULL;
+	Entry *entry = findEntry(table->entries, table->capacity, key, hash);
+	bool isNewKey = IS_NIL(entry->key);
 	
 	// Increase table load if the entry is new and not a reused tombstone.
 	if (isNewKey && IS_NIL(entry->value)) {
@@ -105,28 +151,46 @@ bool tableSet(Table *table, ObjString *key, Value value) {
 	return isNewKey;
 }
 
-bool tableDelete(Table *table, ObjString *key) {
+bool tableSet(Table *table, ObjString *key, Value value) {
+	return setEntry(table, OBJ_VAL(key), key->hash, value);
+}
+
+bool tableSetValue(Table *table, Value key, Value value) {
+	return setEntry(table, key, hashValue(key), value);
+}
+
+// Delete an entry in a hash table from a key and its hash and return whether
+// it existed.
+static bool deleteEntry(Table *table, Value key, uint32_t hash) {
 	if (table->count == 0) {
 		return false;
 	}
 	
-	Entry *entry = findEntry(table->entries, table->capacity, key);
+	Entry *entry = findEntry(table->entries, table->capacity, key, hash);
 	
-	if (entry->key == NULL) {
+	if (IS_NIL(entry->key)) {
 		return false;
 	}
 	
-	entry->key = NULL;
+	entry->key = NIL_VAL;
 	entry->value = BOOL_VAL(true); // Mark entry as tombstone.
 	return true;
 }
 
+bool tableDelete(Table *table, ObjString *key) {
+	return deleteEntry(table, OBJ_VAL(key), key->hash);
+}
+
+bool tableDeleteValue(Table *table, Value key) {
+	return deleteEntry(table, key, hashValue(key));
+}
+
 void tableAddAll(Table *from, Table *to) {
 	for (int i = 0; i < from->capacity; i++) {
 		Entry *entry = &from->entries[i];
 		
-		if (entry->key != NULL) {
-			tableSet(to, entry->key, entry->value);
+		if (!IS_NIL(entry->key)) {
+			tableSetValue(to, entry->key, entry->value);
 		}
 	}
 }
@@ -141,15 +205,19 @@ ObjString *tableFindString(Table *table, const char *chars, int length, uint32_t
 	for (;;) {
 		Entry *entry = &table->entries[index];
 		
-		if (entry->key == NULL) {
+		if (IS_NIL(entry->key)) {
 			if (IS_NIL(entry->value)) {
 				return NULL; // Only stop if entry is not a tombstone.
 			}
-		} else if (
-				entry->key->length == length
-				&& entry->key->hash == hash
-				&& memcmp(entry->key->chars, chars, length) == 0) {
-			return entry->key;
+		} else {
+			ObjString *key = AS_STRING(entry->key);
+			
+			if (
+					key->length == length
+					&& key->hash == hash
+					&& memcmp(key->chars, chars, length) == 0) {
+				return key;
+			}
 		}
 		
 		index = (index + 1) & (table->capacity - 1);
@@ -160,8 +228,8 @@ void tableRemoveWhite(Table *table) {
 	for (int i = 0; i < table->capacity; i++) {
 		Entry *entry = &table->entries[i];
 		
-		if (entry->key != NULL && !entry->key->obj.isMarked) {
-			tableDelete(table, entry->key);
+		if (!IS_NIL(entry->key) && !AS_OBJ(entry->key)->isMarked) {
+			tableDeleteValue(table, entry->key);
 		}
 	}
 }
@@ -169,7 +237,7 @@ void tableRemoveWhite(Table *table) {
 void markTable(Table *table) {
 	for (int i = 0; i < table->capacity; i++) {
 		Entry *entry = &table->entries[i];
-		markObject((Obj*)entry->key);
+		markValue(entry->key);
 		markValue(entry->value);
 	}
 }
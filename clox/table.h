@@ -6,8 +6,8 @@
 
 // A key-value pair entry of a hash table.
 typedef struct {
-	// The entry's key.
-	ObjString *key;
+	// The entry's key, or nil if the entry is empty.
+	Value key;
 	
 	// The entry's value.
 	Value value;
@@ -40,6 +40,17 @@ bool tableSet(Table *table, ObjString *key, Value value);
 // Delete an entry in a hash table and return whether it existed.
 bool tableDelete(Table *table, ObjString *key);
 
+// Get a value from a hash table from a value key in a pointer and return
+// whether it exists.
+bool tableGetValue(Table *table, Value key, Value *value);
+
+// Set an entry in a hash table from a value key and return whether it is new.
+bool tableSetValue(Table *table, Value key, Value value);
+
+// Delete an entry in a hash table from a value key and return whether it
+// existed.
+bool tableDeleteValue(Table *table, Value key);
+
 // Copy all entries from one hash table to another hash table.
 void tableAddAll(Table *from, Table *to);
 
@@ -0,0 +1,24 @@
+#ifdef __linux__
+#define _POSIX_C_SOURCE 200809L
+#endif // __linux__
+
+#include <time.h>
+
+#include "timing.h"
+
+#ifdef __linux__
+
+uint64_t getNanoseconds() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+#else // __linux__
+
+uint64_t getNanoseconds() {
+	// Processor time is the closest monotonic clock in standard C.
+	return (uint64_t)((double)clock() / CLOCKS_PER_SEC * 1e9);
+}
+
+#endif // !__linux__
@@ -0,0 +1,9 @@
+#ifndef clox_timing_h
+#define clox_timing_h
+
+#include "common.h"
+
+// Get the current time of a monotonic clock in nanoseconds.
+uint64_t getNanoseconds();
+
+#endif // !clox_timing_h
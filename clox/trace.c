@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "timing.h"
+#include "trace.h"
+
+// The minimum duration in nanoseconds of a native call to record.
+#define TRACE_NATIVE_MIN 50000
+
+bool isTracingEvents = false;
+
+// The file to write trace events to.
+static FILE *traceFile = NULL;
+
+// The time trace events started being recorded in nanoseconds.
+static uint64_t traceStartTime = 0;
+
+// The number of written trace events.
+static uint64_t traceEventCount = 0;
+
+// The number of begun events that have not ended.
+static int openEventCount = 0;
+
+// Write a trace event from its name, category, phase, start time in
+// nanoseconds, and duration in nanoseconds for complete events.
+static void writeTraceEvent(
+		const char *name, const char *category, char phase, uint64_t start, uint64_t duration) {
+	fprintf(traceFile, "%s\n{", traceEventCount++ > 0 ? "," : "");
+	
+	if (name != NULL) {
+		fprintf(traceFile, "\"name\":\"%s\",\"cat\":\"%s\",", name, category);
+	}
+	
+	fprintf(
+			traceFile, "\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1",
+			phase, (double)(start - traceStartTime) / 1e3);
+	
+	if (phase == 'X') {
+		fprintf(traceFile, ",\"dur\":%.3f", (double)duration / 1e3);
+	}
+	
+	fprintf(traceFile, "}");
+}
+
+// End any open events and finish writing the trace events.
+static void writeTraceEvents() {
+	while (openEventCount > 0) {
+		endTraceEvent();
+	}
+	
+	isTracingEvents = false;
+	fprintf(traceFile, "\n]}\n");
+	
+	if (fclose(traceFile) == EOF) {
+		fprintf(stderr, "Could not write trace events.\n");
+	}
+	
+	traceFile = NULL;
+}
+
+bool initTraceEvents(const char *path) {
+	traceFile = fopen(path, "wb");
+	
+	if (traceFile == NULL) {
+		return false; // Could not open trace events file.
+	}
+	
+	isTracingEvents = true;
+	traceStartTime = getNanoseconds();
+	fprintf(traceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	atexit(writeTraceEvents);
+	return true;
+}
+
+void beginTraceEvent(const char *name, const char *category) {
+	if (!isTracingEvents) {
+		return;
+	}
+	
+	writeTraceEvent(name, category, 'B', getNanoseconds(), 0);
+	openEventCount++;
+}
+
+void endTraceEvent() {
+	if (!isTracingEvents || openEventCount == 0) {
+		return;
+	}
+	
+	writeTraceEvent(NULL, NULL, 'E', getNanoseconds(), 0);
+	openEventCount--;
+}
+
+void traceNativeCall(const char *name, uint64_t start) {
+	uint64_t duration = getNanoseconds() - start;
+	
+	// Native calls are written as complete events after they return, so that
+	// fast calls are never written.
+	if (duration >= TRACE_NATIVE_MIN) {
+		writeTraceEvent(name, "native", 'X', start, duration);
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef clox_trace_h
+#define clox_trace_h
+
+#include "common.h"
+
+// Whether trace events are being recorded.
+extern bool isTracingEvents;
+
+// Start recording trace events to write in the Chrome trace event format to a
+// path, and return whether recording was started.
+bool initTraceEvents(const char *path);
+
+// Record the beginning of an event from its name and category. Does nothing if
+// trace events are not being recorded.
+void beginTraceEvent(const char *name, const char *category);
+
+// Record the end of the most recently begun event. Does nothing if trace events
+// are not being recorded.
+void endTraceEvent();
+
+// Record a call to a native from its name and the time it started in
+// nanoseconds if it took long enough to be interesting.
+void traceNativeCall(const char *name, uint64_t start);
+
+#endif // !clox_trace_h
@@ -3,6 +3,7 @@
 
 #include "object.h"
 #include "memory.h"
+#include "number.h"
 #include "value.h"
 
 void initValueArray(ValueArray *array) {
@@ -27,6 +28,13 @@ void freeValueArray(ValueArray *array) {
 	initValueArray(array);
 }
 
+// Print a number value's shortest representation.
+static void printNumber(double number) {
+	char buffer[NUMBER_BUFFER_SIZE];
+	formatNumber(number, buffer, true);
+	printf("%s", buffer);
+}
+
 void printValue(Value value) {
 #ifdef NAN_BOXING
 	if (IS_BOOL(value)) {
@@ -34,7 +42,7 @@ void printValue(Value value) {
 	} else if (IS_NIL(value)) {
 		printf("nil");
 	} else if (IS_NUMBER(value)) {
-		printf("%g", AS_NUMBER(value));
+		printNumber(AS_NUMBER(value));
 	} else if (IS_OBJ(value)) {
 		printObject(value);
 	}
@@ -42,7 +50,7 @@ void printValue(Value value) {
 	switch (value.type) {
 		case VAL_BOOL: printf(AS_BOOL(value) ? "true" : "false"); break;
 		case VAL_NIL: printf("nil"); break;
-		case VAL_NUMBER: printf("%g", AS_NUMBER(value)); break;
+		case VAL_NUMBER: printNumber(AS_NUMBER(value)); break;
 		case VAL_OBJ: printObject(value); break;
 	}
 #endif // !NAN_BOXING
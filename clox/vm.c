@@ -1,14 +1,21 @@
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 #include "common.h"
 #include "compiler.h"
+#include "coverage.h"
 #include "debug.h"
+#include "funcstats.h"
 #include "object.h"
 #include "memory.h"
+#include "profiler.h"
+#include "timing.h"
+#include "trace.h"
 #include "vm.h"
+#include "vmstats.h"
 
 #ifdef EXTENSIONS
 #include "extension.h"
@@ -16,23 +23,41 @@
 
 VM vm;
 
+bool isRecordingInstructions = false;
+
 // The native clock function.
-static Value clockNative(int argCount, Value *args) {
-	(void)argCount; // Unused parameter.
+static Value clockNative(Value *args) {
 	(void)args; // Unused parameter.
 	
 	return NUMBER_VAL((double)clock() / CLOCKS_PER_SEC);
 }
 
+// Record an executed instruction from its function and offset.
+static void recordInstruction(ObjFunction *function, int offset) {
+	if (isRecordingVMStats) {
+		countInstruction();
+	}
+	
+	if (isRecordingCoverage) {
+		recordCoverage(function, offset);
+	}
+}
+
 // Reset the stack.
 static void resetStack() {
 	vm.stackTop = vm.stack;
 	vm.frameCount = 0;
 	vm.openUpvalues = NULL;
+	
+	if (isRecordingCalls) {
+		leaveCalls();
+	}
 }
 
 // Log a runtime error.
 static void runtimeError(const char *format, ...) {
+	fflush(stdout); // Keep earlier output before the error.
+	
 	va_list args;
 	va_start(args, format);
 	vfprintf(stderr, format, args);
@@ -43,7 +68,7 @@ static void runtimeError(const char *format, ...) {
 		CallFrame *frame = &vm.frames[i];
 		ObjFunction *function = frame->closure->function;
 		size_t instruction = frame->ip - function->chunk.code - 1;
-		fprintf(stderr, "[line %d] in ", function->chunk.lines[instruction]);
+		fprintf(stderr, "[line %d] in ", getLine(&function->chunk, (int)instruction));
 		
 		if (function->name == NULL) {
 			fprintf(stderr, "script\n");
@@ -52,20 +77,30 @@ static void runtimeError(const char *format, ...) {
 		}
 	}
 	
+	fflush(stderr);
 	resetStack();
 }
 
-// Define a new native from a name and function pointer.
-static void defineNative(const char *name, NativeFn function) {
+// Define a new native from a name, function pointer, and signature.
+static void defineNative(const char *name, NativeFn function, const char *signature) {
 	push(OBJ_VAL(copyString(name, (int)strlen(name))));
-	push(OBJ_VAL(newNative(function)));
+	push(OBJ_VAL(newNative(function, signature, AS_STRING(vm.stack[0]))));
 	tableSet(&vm.globals, AS_STRING(vm.stack[0]), vm.stack[1]);
 	pop();
 	pop();
 }
 
 void initVM() {
+	vm.frames = NULL;
+	vm.frameCapacity = 0;
+	vm.maxFrames = FRAMES_DEFAULT_MAX;
+	vm.stack = NULL;
+	vm.stackCapacity = 0;
+	vm.stackLimit = NULL;
 	resetStack();
+	reserveFrames(1);
+	reserveStack(STACK_HEADROOM);
+	
 	vm.objects = NULL;
 	vm.bytesAllocated = 0;
 	vm.nextGC = 1024 * 1024;
@@ -80,7 +115,11 @@ void initVM() {
 	vm.initString = NULL;
 	vm.initString = copyString("init", 4);
 	
-	defineNative("clock", clockNative);
+	defineNative("clock", clockNative, "");
+	
+#ifdef DEBUG_OPCODE_STATS
+	atexit(printOpcodeStats);
+#endif // DEBUG_OPCODE_STATS
 	
 #ifdef EXTENSIONS
 	defineExtensions(defineNative);
@@ -92,9 +131,72 @@ void freeVM() {
 	freeTable(&vm.strings);
 	vm.initString = NULL;
 	freeObjects();
+	free(vm.frames);
+	free(vm.stack);
+}
+
+// Get a capacity for an array grown from a current capacity to fit a count.
+static int growCapacity(int capacity, int count) {
+	capacity = capacity < 8 ? 8 : capacity;
+	
+	while (capacity < count) {
+		capacity *= 2;
+	}
+	
+	return capacity;
+}
+
+void reserveStack(int count) {
+	if (count <= vm.stackCapacity) {
+		return;
+	}
+	
+	int capacity = growCapacity(vm.stackCapacity * 2, count);
+	Value *stack = (Value*)malloc(sizeof(Value) * capacity);
+	
+	if (stack == NULL) {
+		exit(1);
+	}
+	
+	if (vm.stack != NULL) {
+		memcpy(stack, vm.stack, sizeof(Value) * (vm.stackTop - vm.stack));
+	}
+	
+	for (int i = 0; i < vm.frameCount; i++) {
+		vm.frames[i].slots = stack + (vm.frames[i].slots - vm.stack);
+	}
+	
+	for (ObjUpvalue *upvalue = vm.openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		upvalue->location = stack + (upvalue->location - vm.stack);
+	}
+	
+	vm.stackTop = stack + (vm.stackTop - vm.stack);
+	free(vm.stack);
+	vm.stack = stack;
+	vm.stackCapacity = capacity;
+	vm.stackLimit = stack + capacity;
+}
+
+void reserveFrames(int count) {
+	if (count <= vm.frameCapacity) {
+		return;
+	}
+	
+	vm.frameCapacity = growCapacity(vm.frameCapacity * 2, count);
+	vm.frames = (CallFrame*)realloc(vm.frames, sizeof(CallFrame) * vm.frameCapacity);
+	
+	if (vm.frames == NULL) {
+		exit(1);
+	}
 }
 
 void push(Value value) {
+	// Calls reserve headroom for temporaries, but deeply nested expressions
+	// can still need more.
+	if (vm.stackTop == vm.stackLimit) {
+		reserveStack(vm.stackCapacity + 1);
+	}
+	
 	*vm.stackTop = value;
 	vm.stackTop++;
 }
@@ -104,6 +206,11 @@ Value pop() {
 	return *vm.stackTop;
 }
 
+void flushOutput() {
+	fflush(stdout);
+	fflush(stderr);
+}
+
 // Get the value at a distance from the top of the stack.
 static Value peek(int distance) {
 	return vm.stackTop[-1 - distance];
@@ -116,18 +223,85 @@ static bool call(ObjClosure *closure, int argCount) {
 		return false;
 	}
 	
-	if (vm.frameCount == FRAMES_MAX) {
+	if (vm.frameCount == vm.maxFrames) {
 		runtimeError("Stack overflow.");
 		return false;
 	}
 	
+	int slots = (int)(vm.stackTop - vm.stack) - argCount - 1;
+	reserveStack(slots + closure->function->slotCount + STACK_HEADROOM);
+	reserveFrames(vm.frameCount + 1);
+	
 	CallFrame *frame = &vm.frames[vm.frameCount++];
 	frame->closure = closure;
 	frame->ip = closure->function->chunk.code;
-	frame->slots = vm.stackTop - argCount - 1;
+	frame->slots = vm.stack + slots;
+	
+	if (isRecordingCalls) {
+		enterCall((Obj*)closure->function);
+	}
+	
 	return true;
 }
 
+// Get whether a value matches a native signature's type code.
+static bool matchesType(char type, Value value) {
+	switch (type) {
+		case 'a': return IS_ARRAY(value);
+		case 'b': return IS_STRING_BUILDER(value);
+		case 'm': return IS_MAP(value);
+		case 'n': return IS_NUMBER(value);
+		case 's': return IS_STRING(value);
+		default: return true; // Any value.
+	}
+}
+
+// Call a native with its arguments while recording its call statistics or
+// trace events, and return its result.
+static Value callProfiledNative(ObjNative *native, Value *args) {
+	if (isRecordingCalls) {
+		enterCall((Obj*)native);
+	}
+	
+	uint64_t start = isTracingEvents ? getNanoseconds() : 0;
+	Value result = native->function(args);
+	
+	if (isTracingEvents) {
+		traceNativeCall(native->name->chars, start);
+	}
+	
+	if (isRecordingCalls) {
+		leaveCall();
+	}
+	
+	return result;
+}
+
+// Call a native with an argument count. The native's result replaces the
+// callee and its arguments, or nil if the arguments do not match its
+// signature.
+static void callNative(ObjNative *native, int argCount) {
+	Value *args = vm.stackTop - argCount;
+	Value result = NIL_VAL;
+	
+	if (argCount == native->arity) {
+		bool isMatching = true;
+		
+		for (int i = 0; i < argCount && isMatching; i++) {
+			isMatching = matchesType(native->signature[i], args[i]);
+		}
+		
+		if (isMatching && (isRecordingCalls || isTracingEvents)) {
+			result = callProfiledNative(native, args);
+		} else if (isMatching) {
+			result = native->function(args);
+		}
+	}
+	
+	vm.stackTop -= argCount + 1;
+	push(result);
+}
+
 // Call a value with an argument count and return whether the call is valid.
 static bool callValue(Value callee, int argCount) {
 	if (IS_OBJ(callee)) {
@@ -158,10 +332,7 @@ static bool callValue(Value callee, int argCount) {
 			}
 			
 			case OBJ_NATIVE: {
-				NativeFn native = AS_NATIVE(callee);
-				Value result = native(argCount, vm.stackTop - argCount);
-				vm.stackTop -= argCount + 1;
-				push(result);
+				callNative(AS_NATIVE(callee), argCount);
 				return true;
 			}
 			
@@ -260,6 +431,20 @@ static void closeUpvalues(Value *last) {
 	}
 }
 
+// Remove the current call frame and move a call's callee and arguments down to
+// its slots for a tail call.
+static void dropFrame(int argCount) {
+	CallFrame *frame = &vm.frames[vm.frameCount - 1];
+	closeUpvalues(frame->slots);
+	memmove(frame->slots, vm.stackTop - argCount - 1, sizeof(Value) * (argCount + 1));
+	vm.stackTop = frame->slots + argCount + 1;
+	vm.frameCount--;
+	
+	if (isRecordingCalls) {
+		leaveCall();
+	}
+}
+
 // Define a method on the stack.
 static void defineMethod(ObjString *name) {
 	Value method = peek(0);
@@ -357,6 +542,20 @@ static InterpretResult run() {
 				(int)(frame->ip - frame->closure->function->chunk.code));
 #endif // DEBUG_TRACE_EXECUTION
 		
+#ifdef DEBUG_OPCODE_STATS
+		recordOpcode(*frame->ip);
+#endif // DEBUG_OPCODE_STATS
+		
+		if (isProfileSampleDue) {
+			sampleProfile();
+		}
+		
+		if (isRecordingInstructions) {
+			recordInstruction(
+					frame->closure->function,
+					(int)(frame->ip - frame->closure->function->chunk.code));
+		}
+		
 		uint8_t instruction;
 		
 		switch (instruction = READ_BYTE()) {
@@ -392,12 +591,24 @@ static InterpretResult run() {
 				break;
 			}
 			
+			case OP_GET_LOCAL_LONG: {
+				uint16_t slot = READ_SHORT();
+				push(frame->slots[slot]);
+				break;
+			}
+			
 			case OP_SET_LOCAL: {
 				uint8_t slot = READ_BYTE();
 				frame->slots[slot] = peek(0);
 				break;
 			}
 			
+			case OP_SET_LOCAL_LONG: {
+				uint16_t slot = READ_SHORT();
+				frame->slots[slot] = peek(0);
+				break;
+			}
+			
 			case OP_GET_GLOBAL: {
 				ObjString *name = READ_STRING();
 				Value value;
@@ -436,12 +647,24 @@ static InterpretResult run() {
 				break;
 			}
 			
+			case OP_GET_UPVALUE_LONG: {
+				uint16_t slot = READ_SHORT();
+				push(*frame->closure->upvalues[slot]->location);
+				break;
+			}
+			
 			case OP_SET_UPVALUE: {
 				uint8_t slot = READ_BYTE();
 				*frame->closure->upvalues[slot]->location = peek(0);
 				break;
 			}
 			
+			case OP_SET_UPVALUE_LONG: {
+				uint16_t slot = READ_SHORT();
+				*frame->closure->upvalues[slot]->location = peek(0);
+				break;
+			}
+			
 			case OP_GET_PROPERTY: {
 				if (!IS_INSTANCE(peek(0))) {
 					runtimeError("Only instances have properties.");
@@ -555,7 +778,7 @@ static InterpretResult run() {
 			
 			case OP_PRINT: {
 				printValue(pop());
-				printf("\n");
+				putchar('\n');
 				break;
 			}
 			
@@ -592,6 +815,35 @@ static InterpretResult run() {
 				break;
 			}
 			
+			case OP_CALL_NATIVE: {
+				int argCount = READ_BYTE();
+				Value callee = peek(argCount);
+				
+				if (IS_NATIVE(callee)) {
+					callNative(AS_NATIVE(callee), argCount);
+					break;
+				}
+				
+				if (!callValue(callee, argCount)) {
+					return INTERPRET_RUNTIME_ERROR;
+				}
+				
+				frame = &vm.frames[vm.frameCount - 1];
+				break;
+			}
+			
+			case OP_TAIL_CALL: {
+				int argCount = READ_BYTE();
+				dropFrame(argCount);
+				
+				if (!callValue(peek(argCount), argCount)) {
+					return INTERPRET_RUNTIME_ERROR;
+				}
+				
+				frame = &vm.frames[vm.frameCount - 1];
+				break;
+			}
+			
 			case OP_INVOKE: {
 				ObjString *method = READ_STRING();
 				int argCount = READ_BYTE();
@@ -604,6 +856,19 @@ static InterpretResult run() {
 				break;
 			}
 			
+			case OP_TAIL_INVOKE: {
+				ObjString *method = READ_STRING();
+				int argCount = READ_BYTE();
+				dropFrame(argCount);
+				
+				if (!invoke(method, argCount)) {
+					return INTERPRET_RUNTIME_ERROR;
+				}
+				
+				frame = &vm.frames[vm.frameCount - 1];
+				break;
+			}
+			
 			case OP_SUPER_INVOKE: {
 				ObjString *method = READ_STRING();
 				int argCount = READ_BYTE();
@@ -623,10 +888,10 @@ static InterpretResult run() {
 				push(OBJ_VAL(closure));
 				
 				for (int i = 0; i < closure->upvalueCount; i++) {
-					uint8_t isLocal = READ_BYTE();
-					uint8_t index = READ_BYTE();
+					uint8_t flags = READ_BYTE();
+					uint16_t index = (flags & UPVALUE_LONG) ? READ_SHORT() : READ_BYTE();
 					
-					if (isLocal) {
+					if (flags & UPVALUE_LOCAL) {
 						closure->upvalues[i] = captureUpvalue(frame->slots + index);
 					} else {
 						closure->upvalues[i] = frame->closure->upvalues[index];
@@ -647,6 +912,10 @@ static InterpretResult run() {
 				closeUpvalues(frame->slots); // Close parameter upvalues.
 				vm.frameCount--;
 				
+				if (isRecordingCalls) {
+					leaveCall();
+				}
+				
 				if (vm.frameCount == 0) {
 					pop();
 					return INTERPRET_OK;
@@ -692,7 +961,9 @@ static InterpretResult run() {
 #undef BINARY_OP
 
 InterpretResult interpret(const char *source) {
+	beginTraceEvent("compile", "compiler");
 	ObjFunction *function = compile(source);
+	endTraceEvent();
 	
 	if (function == NULL) {
 		return INTERPRET_COMPILE_ERROR;
@@ -702,7 +973,20 @@ InterpretResult interpret(const char *source) {
 	ObjClosure *closure = newClosure(function);
 	pop();
 	push(OBJ_VAL(closure));
-	call(closure, 0);
 	
-	return run();
+	if (!call(closure, 0)) {
+		return INTERPRET_RUNTIME_ERROR;
+	}
+	
+	beginTraceEvent("run", "script");
+	InterpretResult result = run();
+	endTraceEvent();
+	return result;
+}
+
+InterpretResult resume() {
+	beginTraceEvent("resume", "script");
+	InterpretResult result = run();
+	endTraceEvent();
+	return result;
 }
@@ -6,20 +6,18 @@
 #include "table.h"
 #include "value.h"
 
-#ifdef DEEP_CALLS
+// The default maximum function call depth.
+#define FRAMES_DEFAULT_MAX 1024
 
-// The maximum function call depth of 128.
-#define FRAMES_MAX 128
+// The default buffer size of the standard output and error streams.
+#define OUTPUT_BUFFER_DEFAULT (1 << 16)
 
-#else // DEEP_CALLS
+// The maximum buffer size of the standard output and error streams.
+#define OUTPUT_BUFFER_MAX (1 << 24)
 
-// The maximum function call depth of 64.
-#define FRAMES_MAX 64
-
-#endif // !DEEP_CALLS
-
-// The maximum size of the stack in values.
-#define STACK_MAX (FRAMES_MAX * UINT8_COUNT)
+// The number of stack values reserved above a call's locals for temporaries
+// before the stack has to grow while pushing.
+#define STACK_HEADROOM UINT8_COUNT
 
 // A function call's state.
 typedef struct {
@@ -36,17 +34,29 @@ typedef struct {
 // A virtual machine for interpreting bytecode.
 typedef struct {
 	// The stack of function call frames.
-	CallFrame frames[FRAMES_MAX];
+	CallFrame *frames;
 	
 	// The current function call depth.
 	int frameCount;
 	
+	// The current maximum number of call frames before the frames grow.
+	int frameCapacity;
+	
+	// The maximum function call depth before a stack overflow.
+	int maxFrames;
+	
 	// The stack of local values.
-	Value stack[STACK_MAX];
+	Value *stack;
 	
 	// The pointer to the next top value of the stack.
 	Value *stackTop;
 	
+	// The current maximum number of values before the stack grows.
+	int stackCapacity;
+	
+	// The pointer past the last value the stack can hold before it grows.
+	Value *stackLimit;
+	
 	// The table of globals.
 	Table globals;
 	
@@ -93,6 +103,10 @@ typedef enum {
 // The global virtual machine instance.
 extern VM vm;
 
+// Whether executed instructions are being recorded for virtual machine
+// statistics or coverage.
+extern bool isRecordingInstructions;
+
 // Initialize the virtual machine.
 void initVM();
 
@@ -102,10 +116,23 @@ void freeVM();
 // Interpret source code.
 InterpretResult interpret(const char *source);
 
-// Push a value to the stack.
+// Continue interpreting from the current call frames.
+InterpretResult resume();
+
+// Ensure the stack can hold a number of values, relocating pointers into the
+// stack if it grows.
+void reserveStack(int count);
+
+// Ensure the call frames can hold a number of frames.
+void reserveFrames(int count);
+
+// Push a value to the stack, growing the stack if it is full.
 void push(Value value);
 
 // Pop a value from the stack.
 Value pop();
 
+// Flush the standard output and error streams.
+void flushOutput();
+
 #endif // !clox_vm_h
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "timing.h"
+#include "vm.h"
+#include "vmstats.h"
+
+bool isRecordingVMStats = false;
+
+// The file to write virtual machine statistics to at exit.
+static FILE *vmStatsFile = NULL;
+
+// The time virtual machine statistics started being recorded in nanoseconds.
+static uint64_t vmStatsStartTime = 0;
+
+// The number of executed instructions.
+static uint64_t instructionCount = 0;
+
+// The number of garbage collections.
+static uint64_t collectionCount = 0;
+
+// The total time spent collecting garbage in nanoseconds.
+static uint64_t collectionTime = 0;
+
+// The peak number of managed allocated bytes.
+static size_t peakBytesAllocated = 0;
+
+// Write the virtual machine statistics to the virtual machine statistics file.
+static void writeVMStats() {
+	isRecordingVMStats = false;
+	double elapsedTime = (double)(getNanoseconds() - vmStatsStartTime) / 1e6;
+	fprintf(vmStatsFile, "elapsed_ms\t%.3f\n", elapsedTime);
+	fprintf(vmStatsFile, "instructions\t%llu\n", (unsigned long long)instructionCount);
+	fprintf(vmStatsFile, "collections\t%llu\n", (unsigned long long)collectionCount);
+	fprintf(vmStatsFile, "collection_ms\t%.3f\n", (double)collectionTime / 1e6);
+	fprintf(vmStatsFile, "peak_heap_bytes\t%zu\n", peakBytesAllocated);
+	
+	if (fclose(vmStatsFile) == EOF) {
+		fprintf(stderr, "Could not write VM stats.\n");
+	}
+	
+	vmStatsFile = NULL;
+}
+
+bool initVMStats(const char *path) {
+	vmStatsFile = fopen(path, "wb");
+	
+	if (vmStatsFile == NULL) {
+		return false; // Could not open VM stats file.
+	}
+	
+	isRecordingVMStats = true;
+	isRecordingInstructions = true;
+	vmStatsStartTime = getNanoseconds();
+	peakBytesAllocated = vm.bytesAllocated;
+	atexit(writeVMStats);
+	return true;
+}
+
+void countInstruction() {
+	instructionCount++;
+}
+
+void recordHeapSize() {
+	if (vm.bytesAllocated > peakBytesAllocated) {
+		peakBytesAllocated = vm.bytesAllocated;
+	}
+}
+
+void recordCollection(uint64_t nanoseconds) {
+	collectionCount++;
+	collectionTime += nanoseconds;
+}
@@ -0,0 +1,22 @@
+#ifndef clox_vmstats_h
+#define clox_vmstats_h
+
+#include "common.h"
+
+// Whether virtual machine statistics are being recorded.
+extern bool isRecordingVMStats;
+
+// Start recording virtual machine statistics to write as tab-separated values
+// to a path at exit, and return whether recording was started.
+bool initVMStats(const char *path);
+
+// Count an executed instruction.
+void countInstruction();
+
+// Record the current number of managed allocated bytes.
+void recordHeapSize();
+
+// Record a garbage collection and the nanoseconds it took.
+void recordCollection(uint64_t nanoseconds);
+
+#endif // !clox_vmstats_h